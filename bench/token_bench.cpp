@@ -0,0 +1,94 @@
+#include <bench_utils.h>
+#include <token_utils.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+using namespace Utils::TokenUtils;
+using namespace Utils::TokenUtils::Tokenizer;
+
+namespace {
+    // words, numbers and punctuation mixed like ordinary source text
+    std::string sampleText(size_t bytes){
+        static constexpr const char* pieces[] = { "alpha ", "beta, ", "x1 ", "42 ", "3.25 ", "(a + b) ", "* ", "gamma;\n", "delta\t" };
+        std::mt19937 random(7);
+        std::string text;
+        text.reserve(bytes + 16);
+        while (text.size() < bytes) text += pieces[random() % std::size(pieces)];
+        text.resize(bytes);
+        return text;
+    }
+
+    // short formulas over constants and functions, one in a hundred divides by zero to keep the error path warm
+    std::vector<std::string> sampleFormulas(size_t count){
+        static constexpr const char* shapes[] = { "1 + 2 * 3", "sqrt(16) + 2.5e1 / 5", "max(1, 4, 2) ^ 2 - .5", "(1 + 2) * (3 + 4) % 5", "-sin(30) + cos(60) * 2" };
+        std::mt19937 random(11);
+        std::vector<std::string> formulas;
+        formulas.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            formulas.emplace_back(i % 100 == 99 ? "7 % 0" : shapes[random() % std::size(shapes)]);
+        }
+        return formulas;
+    }
+
+    // written once per size and left in the temp directory for later runs
+    std::string sampleFile(size_t bytes){
+        const std::filesystem::path path = std::filesystem::temp_directory_path() / ("cakilgan_bench_" + std::to_string(bytes) + ".txt");
+        std::error_code error;
+        if (std::filesystem::file_size(path, error) != bytes) {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            const std::string text = sampleText(bytes);
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        }
+        return path.string();
+    }
+
+    constexpr size_t FILE_BENCH_BYTES = 16 << 20;
+
+    // 1, 2, 4, ... and the core count itself when it is not a power of two
+    std::vector<size_t> threadCounts(){
+        const size_t cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+        std::vector<size_t> counts;
+        for (size_t threads = 1; threads < cores; threads *= 2) counts.push_back(threads);
+        counts.push_back(cores);
+        return counts;
+    }
+}
+
+// usage: CakilganCoreBench [baseline.json] [results.json]
+int main(int argc, char** argv){
+    BOLT_BENCH(tokenizeFileSingle, maps a file and tokenizes it with defaultTokenize on one thread, [](BoltBenchState& state) {
+        const MappedFile file(sampleFile(state.range()));
+        std::vector<WordSpan> words;
+        for (auto _ : state) {
+            std::vector<Token> tokens = defaultTokenize(file.view());
+            words.clear();
+            segmentWords(file.view(), words);
+            Utils::TimeUtils::DoNotOptimize(tokens.size() + words.size());
+        }
+        state.setBytesProcessed(state.range());
+    }, FILE_BENCH_BYTES);
+
+    // state.range() is the thread count here, every run reads the same file as tokenizeFileSingle
+    BOLT_BENCH(tokenizeFileParallel, maps a file and tokenizes it on a growing number of threads, [](BoltBenchState& state) {
+        const std::string path = sampleFile(FILE_BENCH_BYTES);
+        for (auto _ : state) {
+            FileTokenization result = parallelTokenizeFile(path, state.range());
+            Utils::TimeUtils::DoNotOptimize(result.words.size());
+        }
+        state.setBytesProcessed(FILE_BENCH_BYTES);
+    }, threadCounts());
+
+    BOLT_BENCH(bulkEvaluateFormulas, segments parses and evaluates independent formulas on every core, [](BoltBenchState& state) {
+        const std::vector<std::string> formulas = sampleFormulas(state.range());
+        for (auto _ : state) {
+            BulkEvaluation result = bulkEvaluate(std::span<const std::string>(formulas));
+            Utils::TimeUtils::DoNotOptimize(result.failures);
+        }
+        state.setItemsProcessed(state.range());
+    }, 1 << 10, 1 << 16);
+
+    runBenchmarksWithBaseline(argc > 1 ? argv[1] : "", argc > 2 ? argv[2] : "", std::cout);
+    return 0;
+}
@@ -0,0 +1,546 @@
+#ifndef BOLT_BENCH_H
+#define BOLT_BENCH_H
+
+#include "test_utils.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cstdio>
+#include <cctype>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// batches taken per benchmark, each one long enough to drown the clock overhead
+inline static size_t BENCH_SAMPLES = 30;
+inline static std::chrono::nanoseconds BENCH_SAMPLE_TIME = std::chrono::milliseconds(2);
+inline static std::chrono::nanoseconds BENCH_WARMUP = std::chrono::milliseconds(50);
+// a benchmark regresses when it is slower with p < BENCH_ALPHA and its median moved by more than the threshold
+inline static double BENCH_ALPHA = 0.01;
+inline static double BENCH_REGRESSION_THRESHOLD = 0.05;
+inline constexpr int BENCH_BASELINE_VERSION = 1;
+
+namespace Utils::TimeUtils {
+#if defined(_MSC_VER) && !defined(__clang__)
+    inline const volatile void* volatile BENCH_SINK = nullptr;
+
+    template<typename T>
+    inline void DoNotOptimize(const T& value) {
+        BENCH_SINK = &value;
+        _ReadWriteBarrier();
+    }
+    inline void ClobberMemory() {
+        _ReadWriteBarrier();
+    }
+#else
+    // the compiler has to assume value is read (and for lvalues rewritten) here, so it can not be folded away
+    template<typename T>
+    inline void DoNotOptimize(const T& value) {
+        asm volatile("" : : "m"(value) : "memory");
+    }
+    template<typename T>
+    inline void DoNotOptimize(T& value) {
+        if constexpr (std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(T*)) {
+            asm volatile("" : "+m,r"(value) : : "memory");
+        } else {
+            asm volatile("" : "+m"(value) : : "memory");
+        }
+    }
+    inline void ClobberMemory() {
+        asm volatile("" : : : "memory");
+    }
+#endif
+}
+
+class BoltBenchState {
+  public:
+    struct [[maybe_unused]] Value {};
+    struct Iterator {
+        BoltBenchState* state;
+        size_t remaining;
+        inline Value operator*() const { return {}; }
+        inline void operator++() { --remaining; }
+        // the loop condition is the only place that sees the last iteration, so the clock stops here
+        inline bool operator!=(const Iterator&) {
+            if (remaining != 0) return true;
+            state->stop();
+            return false;
+        }
+    };
+
+    BoltBenchState(size_t iterations, size_t size): iterations(iterations), size(size) {}
+
+    inline Iterator begin() {
+        start = std::chrono::steady_clock::now();
+        return { this, iterations };
+    }
+    inline Iterator end() { return { this, 0 }; }
+
+    // excludes per-batch setup from the measurement
+    inline void pauseTiming() { paused = std::chrono::steady_clock::now(); }
+    inline void resumeTiming() { excluded += std::chrono::steady_clock::now() - paused; }
+
+    inline size_t range() const { return size; }
+    inline size_t getIterations() const { return iterations; }
+    inline std::chrono::nanoseconds getElapsed() const { return elapsed; }
+
+    // per iteration
+    inline void setBytesProcessed(size_t bytes) { bytesProcessed = bytes; }
+    inline void setItemsProcessed(size_t items) { itemsProcessed = items; }
+    inline size_t getBytesProcessed() const { return bytesProcessed; }
+    inline size_t getItemsProcessed() const { return itemsProcessed; }
+
+  private:
+    inline void stop() {
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start - excluded);
+    }
+
+    size_t iterations;
+    size_t size;
+    size_t bytesProcessed = 0;
+    size_t itemsProcessed = 0;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point paused;
+    std::chrono::steady_clock::duration excluded{};
+    std::chrono::nanoseconds elapsed{};
+};
+
+struct BoltBench {
+    const char* name;
+    const char* description;
+    std::vector<size_t> sizes;
+    std::function<void(BoltBenchState& state)> bench;
+};
+
+struct BoltBenchResult {
+    std::string name;
+    size_t size = 0;
+    size_t iterations = 0;
+    // nanoseconds per iteration, one entry per batch
+    std::vector<double> samples;
+    double min = 0;
+    double median = 0;
+    double mean = 0;
+    double p99 = 0;
+    double stddev = 0;
+    double bytesPerSecond = 0;
+    double itemsPerSecond = 0;
+    // filled by compareToBaseline, CALCULATED while there is nothing to compare against
+    BoltTestResult result = BoltTestResult::CALCULATED;
+    double baselineMedian = 0;
+    double change = 0;
+    double pValue = 1;
+};
+
+using BoltBenchBaseline = std::unordered_map<std::string, BoltBenchResult>;
+
+inline std::vector<BoltBench>& getBenches() {
+    static std::vector<BoltBench> benches;
+    return benches;
+}
+
+inline void registerBench(BoltBench bench) {
+    getBenches().push_back(bench);
+}
+
+inline void summarizeBench(BoltBenchResult& result) {
+    std::vector<double> sorted = result.samples;
+    std::sort(sorted.begin(), sorted.end());
+    const size_t n = sorted.size();
+    if (n == 0) return;
+
+    result.min = sorted.front();
+    result.median = n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0;
+    result.mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / n;
+    // nearest rank
+    result.p99 = sorted[static_cast<size_t>(std::ceil(0.99 * n)) - 1];
+    double variance = 0;
+    for (double sample : sorted) variance += (sample - result.mean) * (sample - result.mean);
+    result.stddev = n > 1 ? std::sqrt(variance / (n - 1)) : 0.0;
+}
+
+inline std::string formatNanoseconds(double ns) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1);
+    if (ns >= 1e9) oss << ns / 1e9 << " s";
+    else if (ns >= 1e6) oss << ns / 1e6 << " ms";
+    else if (ns >= 1e3) oss << ns / 1e3 << " us";
+    else oss << ns << " ns";
+    return oss.str();
+}
+
+inline std::string formatRate(double perSecond, const char* unit) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2);
+    if (perSecond >= 1e9) oss << perSecond / 1e9 << " G";
+    else if (perSecond >= 1e6) oss << perSecond / 1e6 << " M";
+    else if (perSecond >= 1e3) oss << perSecond / 1e3 << " K";
+    else oss << perSecond << " ";
+    oss << unit << "/s";
+    return oss.str();
+}
+
+inline BoltBenchResult runBench(BoltBench& bench, size_t size) {
+    BoltBenchResult result;
+    result.name = bench.sizes.empty() ? std::string(bench.name) : _str(bench.name, "/", size);
+    result.size = size;
+
+    auto batch = [&](size_t iterations) {
+        BoltBenchState state(iterations, size);
+        bench.bench(state);
+        return state;
+    };
+
+    // the first call pays for page faults and cold caches, it would stop the calibration too early
+    batch(1);
+    // grow the batch until it fills a sample, never more than 10x a step so one slow outlier can not overshoot
+    size_t iterations = 1;
+    const double target = static_cast<double>(BENCH_SAMPLE_TIME.count());
+    for (;;) {
+        const double elapsed = static_cast<double>(batch(iterations).getElapsed().count());
+        if (elapsed >= target || iterations >= (size_t(1) << 40)) break;
+        const double scale = elapsed > 0 ? target * 1.2 / elapsed : 10.0;
+        iterations = static_cast<size_t>(iterations * std::clamp(scale, 2.0, 10.0));
+    }
+    result.iterations = iterations;
+
+    const auto warmupEnd = std::chrono::steady_clock::now() + BENCH_WARMUP;
+    while (std::chrono::steady_clock::now() < warmupEnd) batch(iterations);
+
+    size_t bytes = 0;
+    size_t items = 0;
+    result.samples.reserve(BENCH_SAMPLES);
+    for (size_t i = 0; i < std::max<size_t>(1, BENCH_SAMPLES); ++i) {
+        BoltBenchState state = batch(iterations);
+        result.samples.push_back(static_cast<double>(state.getElapsed().count()) / iterations);
+        bytes = state.getBytesProcessed();
+        items = state.getItemsProcessed();
+    }
+    summarizeBench(result);
+    // rates follow the median so a preempted batch does not drag them down
+    if (result.median > 0) {
+        result.bytesPerSecond = bytes * 1e9 / result.median;
+        result.itemsPerSecond = items * 1e9 / result.median;
+    }
+    return result;
+}
+
+inline void logBenchResult(const BoltBenchResult& result, std::ostream& out) {
+    log(_str("BENCH:: ", result.name, " iterations:: ", result.iterations, " X samples:: ", result.samples.size(), "\n"), out);
+    log("min:: ", out);
+    logWithColor(formatNanoseconds(result.min), Utils::ColorUtils::GREEN, out);
+    log(" X median:: ", out);
+    logWithColor(formatNanoseconds(result.median), Utils::ColorUtils::BRIGHT_BLUE, out);
+    log(" X mean:: " + formatNanoseconds(result.mean), out);
+    log(" X p99:: ", out);
+    logWithColor(formatNanoseconds(result.p99), Utils::ColorUtils::BRIGHT_YELLOW, out);
+    log(" X stddev:: " + formatNanoseconds(result.stddev), out);
+    if (result.bytesPerSecond > 0) log(" X bytes:: " + formatRate(result.bytesPerSecond, "B"), out);
+    if (result.itemsPerSecond > 0) log(" X items:: " + formatRate(result.itemsPerSecond, "items"), out);
+    log("\n", out);
+}
+
+// one-sided Mann-Whitney U test, p-value for "current tends to be slower than baseline",
+// normal approximation with tie and continuity correction
+inline double mannWhitneySlower(const std::vector<double>& baseline, const std::vector<double>& current) {
+    const double n1 = static_cast<double>(baseline.size());
+    const double n2 = static_cast<double>(current.size());
+    if (baseline.empty() || current.empty()) return 1.0;
+
+    std::vector<std::pair<double, bool>> pooled;
+    pooled.reserve(baseline.size() + current.size());
+    for (double sample : baseline) pooled.emplace_back(sample, false);
+    for (double sample : current) pooled.emplace_back(sample, true);
+    std::sort(pooled.begin(), pooled.end());
+
+    const double n = n1 + n2;
+    double currentRanks = 0;
+    double ties = 0;
+    for (size_t i = 0; i < pooled.size();) {
+        size_t j = i;
+        while (j < pooled.size() && pooled[j].first == pooled[i].first) ++j;
+        // tied values share the average of ranks i+1..j
+        const double rank = (i + 1 + j) / 2.0;
+        for (size_t k = i; k < j; ++k) {
+            if (pooled[k].second) currentRanks += rank;
+        }
+        const double t = static_cast<double>(j - i);
+        ties += t * t * t - t;
+        i = j;
+    }
+
+    const double u = currentRanks - n2 * (n2 + 1) / 2.0;
+    const double variance = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1)));
+    if (variance <= 0) return 1.0;
+    const double z = (u - n1 * n2 / 2.0 - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+inline void compareToBaseline(BoltBenchResult& result, const BoltBenchResult& baseline) {
+    result.baselineMedian = baseline.median;
+    result.change = baseline.median > 0 ? result.median / baseline.median - 1.0 : 0.0;
+    result.pValue = mannWhitneySlower(baseline.samples, result.samples);
+    if (result.pValue >= BENCH_ALPHA) result.result = BoltTestResult::PASSED;
+    // significant but within noise of the machine, worth a look and nothing more
+    else if (result.change <= BENCH_REGRESSION_THRESHOLD) result.result = BoltTestResult::SUS_FAIL;
+    else result.result = BoltTestResult::REGRESSION;
+}
+
+inline void writeBenchBaseline(const std::vector<BoltBenchResult>& results, std::ostream& out) {
+    const auto precision = out.precision(std::numeric_limits<double>::max_digits10);
+    out << "{\n\"version\": " << BENCH_BASELINE_VERSION << ",\n\"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BoltBenchResult& result = results[i];
+        out << (i ? ",\n" : "\n");
+        out << "{\"name\": \"";
+        Utils::TimeUtils::writeJsonEscaped(out, result.name);
+        out << "\", ";
+        out << "\"size\": " << result.size << ", ";
+        out << "\"iterations\": " << result.iterations << ", ";
+        out << "\"median\": " << result.median << ", ";
+        out << "\"samples\": [";
+        for (size_t k = 0; k < result.samples.size(); ++k) {
+            out << (k ? ", " : "") << result.samples[k];
+        }
+        out << "]}";
+    }
+    out << "\n]\n}\n";
+    out.precision(precision);
+}
+
+// reads the files written by writeBenchBaseline, unknown keys are skipped so newer writers can add fields
+class BoltBaselineReader {
+  public:
+    explicit BoltBaselineReader(std::istream& in): text(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()) {}
+
+    BoltBenchBaseline read() {
+        BoltBenchBaseline baseline;
+        double version = -1;
+        object([&](const std::string& key) {
+            if (key == "version") {
+                version = number();
+            } else if (key == "benchmarks") {
+                array([&]() {
+                    BoltBenchResult result;
+                    object([&](const std::string& field) {
+                        if (field == "name") result.name = string();
+                        else if (field == "size") result.size = static_cast<size_t>(number());
+                        else if (field == "iterations") result.iterations = static_cast<size_t>(number());
+                        else if (field == "samples") array([&]() { result.samples.push_back(number()); });
+                        else skip();
+                    });
+                    summarizeBench(result);
+                    std::string name = result.name;
+                    baseline[name] = std::move(result);
+                });
+            } else {
+                skip();
+            }
+        });
+        if (version != BENCH_BASELINE_VERSION) throw std::runtime_error(_str("unsupported baseline version ", version));
+        return baseline;
+    }
+
+  private:
+    void whitespace() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) ++pos;
+    }
+    void expect(char c) {
+        whitespace();
+        if (pos >= text.size() || text[pos] != c) throw std::runtime_error(_str("malformed baseline, expected '", c, "' at ", pos));
+        ++pos;
+    }
+    bool consume(char c) {
+        whitespace();
+        if (pos < text.size() && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    std::string string() {
+        expect('"');
+        std::string value;
+        while (pos < text.size() && text[pos] != '"') {
+            char c = text[pos++];
+            if (c == '\\' && pos < text.size()) {
+                c = text[pos++];
+                if (c == 'n') c = '\n';
+                else if (c == 't') c = '\t';
+                else if (c == 'u' && pos + 4 <= text.size()) {
+                    const unsigned code = std::stoul(text.substr(pos, 4), nullptr, 16);
+                    pos += 4;
+                    if (code < 0x80) {
+                        value += static_cast<char>(code);
+                    } else if (code < 0x800) {
+                        value += static_cast<char>(0xC0 | (code >> 6));
+                        value += static_cast<char>(0x80 | (code & 0x3F));
+                    } else {
+                        value += static_cast<char>(0xE0 | (code >> 12));
+                        value += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                        value += static_cast<char>(0x80 | (code & 0x3F));
+                    }
+                    continue;
+                }
+            }
+            value += c;
+        }
+        expect('"');
+        return value;
+    }
+
+    double number() {
+        whitespace();
+        const char* begin = text.c_str() + pos;
+        char* end = nullptr;
+        const double value = std::strtod(begin, &end);
+        if (end == begin) throw std::runtime_error(_str("malformed baseline, expected a number at ", pos));
+        pos += end - begin;
+        return value;
+    }
+
+    template<typename OnKey>
+    void object(OnKey&& onKey) {
+        expect('{');
+        if (consume('}')) return;
+        do {
+            const std::string key = string();
+            expect(':');
+            onKey(key);
+        } while (consume(','));
+        expect('}');
+    }
+
+    template<typename OnValue>
+    void array(OnValue&& onValue) {
+        expect('[');
+        if (consume(']')) return;
+        do {
+            onValue();
+        } while (consume(','));
+        expect(']');
+    }
+
+    void skip() {
+        whitespace();
+        if (pos >= text.size()) throw std::runtime_error("malformed baseline, unexpected end");
+        const char c = text[pos];
+        if (c == '"') string();
+        else if (c == '{') object([&](const std::string&) { skip(); });
+        else if (c == '[') array([&]() { skip(); });
+        else if (text.compare(pos, 4, "true") == 0 || text.compare(pos, 4, "null") == 0) pos += 4;
+        else if (text.compare(pos, 5, "false") == 0) pos += 5;
+        else number();
+    }
+
+    std::string text;
+    size_t pos = 0;
+};
+
+inline BoltBenchBaseline readBenchBaseline(std::istream& in) {
+    return BoltBaselineReader(in).read();
+}
+
+inline void logBaselineComparison(const BoltBenchResult& result, std::ostream& out) {
+    if (result.result == BoltTestResult::CALCULATED) {
+        logWithColorNL("BASELINE:: none", Utils::ColorUtils::BRIGHT_BLACK, out);
+        return;
+    }
+    std::ostringstream change;
+    change << std::showpos << std::fixed << std::setprecision(1) << result.change * 100.0 << "%";
+    std::ostringstream p;
+    p << std::setprecision(2) << result.pValue;
+    log("BASELINE:: median:: " + formatNanoseconds(result.baselineMedian) + " -> " + formatNanoseconds(result.median), out);
+    log(" (" + change.str() + ") X p:: " + p.str() + " X RESULT:: ", out);
+    logWithColorNL(getResultName(result.result), Utils::ColorUtils::getResultColor(result.result), out);
+}
+
+// runs every registered benchmark once per input size, benchmarks are timed one at a time on purpose
+inline std::vector<BoltBenchResult> runBenchmarks(std::ostream& out, std::ostream& timeProfiler = std::cout, const BoltBenchBaseline* baseline = nullptr) {
+    if(TIME_PROFILER_IS_ON){
+        Utils::TimeUtils::Instrumentor::Get().BeginSession("BoltBench",timeProfiler);
+    }
+    std::vector<BoltBenchResult> results;
+    for (auto& bench : getBenches()) {
+        logln(_str("NAME:: ", bench.name), out);
+        logln(_str("DESC:: ", bench.description), out);
+        const std::vector<size_t> sizes = bench.sizes.empty() ? std::vector<size_t>{ 0 } : bench.sizes;
+        for (size_t size : sizes) {
+            if(TIME_PROFILER_IS_ON){
+                PROFILE_SCOPE_CATEGORY(bench.sizes.empty() ? std::string(bench.name) : _str(bench.name, "/", size), TEST);
+                results.push_back(runBench(bench, size));
+            }else{
+                results.push_back(runBench(bench, size));
+            }
+            logBenchResult(results.back(), out);
+            if (baseline) {
+                auto previous = baseline->find(results.back().name);
+                if (previous != baseline->end()) compareToBaseline(results.back(), previous->second);
+                logBaselineComparison(results.back(), out);
+            }
+        }
+    }
+    if(TIME_PROFILER_IS_ON){
+        Utils::TimeUtils::Instrumentor::Get().EndSession();
+    }
+    return results;
+}
+
+// compares against the baseline at baselinePath when it exists and stores this run at resultsPath,
+// pass the same path to both to roll the baseline forward on every run
+inline std::vector<BoltBenchResult> runBenchmarksWithBaseline(const std::string& baselinePath, const std::string& resultsPath, std::ostream& out, std::ostream& timeProfiler = std::cout) {
+    BoltBenchBaseline baseline;
+    if (std::ifstream in{ baselinePath }) {
+        try {
+            baseline = readBenchBaseline(in);
+        } catch (const std::exception& error) {
+            logWithColorNL(_str("[WARNING] Ignoring baseline ", baselinePath, ": ", error.what()), Utils::ColorUtils::BRIGHT_YELLOW, out);
+        }
+    }
+    std::vector<BoltBenchResult> results = runBenchmarks(out, timeProfiler, &baseline);
+
+    BoltTestTally tally;
+    for (const auto& result : results) {
+        if (result.result != BoltTestResult::CALCULATED) tally.add(result.result);
+    }
+    log("SUMMARY:: benchmarks:: " + std::to_string(results.size()), out);
+    log(" pass:: ", out);
+    logWithColor(std::to_string(tally.pass), Utils::ColorUtils::GREEN, out);
+    log(" X sus_fail:: ", out);
+    logWithColor(std::to_string(tally.sus_fail), Utils::ColorUtils::BRIGHT_YELLOW, out);
+    log(" X regression:: ", out);
+    logWithColor(std::to_string(tally.regression), Utils::ColorUtils::MAGENTA, out);
+    log("\n", out);
+
+    if (!resultsPath.empty()) {
+        std::ofstream file{ resultsPath, std::ios::trunc };
+        if (!file) throw std::runtime_error("can not write benchmark results to " + resultsPath);
+        writeBenchBaseline(results, file);
+    }
+    return results;
+}
+
+// the trailing arguments are the input sizes, state.range() returns the one being measured
+#define BOLT_BENCH(NAME, DESCRIPTION, FUNC, ...) \
+    BoltBench NAME; \
+    NAME.name = #NAME; \
+    NAME.description = #DESCRIPTION; \
+    NAME.sizes = { __VA_ARGS__ }; \
+    NAME.bench = FUNC; \
+    registerBench(NAME);
+
+#endif // BOLT_BENCH_H
@@ -1,10 +1,16 @@
 #ifndef _LOGIC_UTILS_H
 #define _LOGIC_UTILS_H
 #include <string>
+#include <concepts>
 namespace Utils::LogicUtils{
     struct canStringfy{
         virtual std::string toString() const = 0;
     };
+    // non-virtual alternative for small value types that can not afford a vtable pointer
+    template<typename T>
+    concept Stringfiable = requires(const T& value) {
+        { value.toString() } -> std::convertible_to<std::string>;
+    };
 }
 
 #endif /* _LOGIC_UTILS_H */
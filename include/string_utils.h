@@ -15,7 +15,7 @@ namespace Utils::StringUtils{
     std::string vec_to_str(const std::vector<T>& vec, const std::string& separator = " ") {
         std::ostringstream oss;
         
-        if constexpr (std::is_base_of<Utils::LogicUtils::canStringfy, T>::value) {
+        if constexpr (Utils::LogicUtils::Stringfiable<T>) {
             for (const auto& e : vec) {
                 oss << e.toString() << separator;
             }
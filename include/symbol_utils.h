@@ -0,0 +1,56 @@
+#ifndef _SYMBOL_UTILS_H
+#define _SYMBOL_UTILS_H
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+namespace Utils::SymbolUtils{
+    using Symbol = uint32_t;
+    inline constexpr Symbol INVALID_SYMBOL = UINT32_MAX;
+
+    // interns every distinct string once into an arena and hands out dense 32-bit ids,
+    // names are null terminated and stay valid for the lifetime of the table
+    class SymbolTable{
+        public:
+        explicit SymbolTable(bool concurrent = false);
+        SymbolTable(const SymbolTable&) = delete;
+        SymbolTable& operator=(const SymbolTable&) = delete;
+
+        Symbol intern(std::string_view text);
+        // INVALID_SYMBOL when text was never interned
+        Symbol find(std::string_view text) const;
+        std::string_view name(Symbol symbol) const;
+
+        size_t size() const;
+        size_t arenaBytes() const;
+
+        // concurrent table for callers that want one per process, nothing interns into it implicitly
+        static SymbolTable& global();
+
+        private:
+        struct Entry{
+            std::string_view text;
+            uint64_t hash;
+        };
+
+        Symbol findLocked(std::string_view text, uint64_t hash) const;
+        Symbol insertLocked(std::string_view text, uint64_t hash);
+        const char* store(std::string_view text);
+        void grow();
+
+        bool concurrent;
+        mutable std::shared_mutex mutex;
+        std::vector<Entry> entries;
+        std::vector<Symbol> slots;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        size_t blockUsed = 0;
+        size_t blockSize = 0;
+        size_t bytes = 0;
+    };
+
+    uint64_t hashText(std::string_view text);
+}
+
+#endif /* _SYMBOL_UTILS_H */
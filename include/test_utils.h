@@ -10,15 +10,38 @@
 #include <vector>
 #include <type_traits>
 #include <sstream>
+#include <atomic>
+#include <algorithm>
+#include <exception>
+#include <deque>
+#include <charconv>
+#include <cstring>
+#include <cstdio>
+#include <system_error>
+#include <string_view>
+#if defined(__unix__) || defined(__APPLE__)
+#define BOLT_CAN_FORK 1
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#else
+#define BOLT_CAN_FORK 0
+#endif
 inline static bool TIME_PROFILER_IS_ON = false;
 inline static bool COLORIZED_MODE = false;
+// false keeps passing assertions out of the log, they are only counted
+inline static bool LOG_PASSED_ASSERTIONS = true;
 
 enum class BoltTestResult {
     PASSED = 0,
     FAILED = 1,
     SUS_PASS = -1,
     SUS_FAIL = -2,
-    CALCULATED = -3
+    CALCULATED = -3,
+    // significantly slower than the stored benchmark baseline
+    REGRESSION = -4
 };
 
 
@@ -34,6 +57,8 @@ inline const char* getResultName(BoltTestResult result) {
         return "SUS_FAIL";
     case BoltTestResult::CALCULATED:
         return "CALCULATED";
+    case BoltTestResult::REGRESSION:
+        return "REGRESSION";
     default:
         return "UNKNOWN:: ERROR";
     }
@@ -51,15 +76,37 @@ namespace Utils::ColorUtils{
             return YELLOW;
         case BoltTestResult::CALCULATED:
             return BRIGHT_MAGENTA;
+        case BoltTestResult::REGRESSION:
+            return MAGENTA;
         default:
             return BRIGHT_RED;
         }
     }
 }
 
+// written once per assertion macro expansion, events only point at it
+struct BoltAssertSite {
+    const char* lhs;
+    const char* op;
+    const char* rhs;
+    const char* file;
+    int line;
+};
+
+// small trivially copyable operand kept by value and formatted when the log is written
+struct BoltOperand {
+    alignas(8) unsigned char bytes[16];
+    std::string (*format)(const void* value) = nullptr;
+};
+
 struct BoltTestEvent{
     BoltTestResult result;
+    // free-form events, or assertions whose operands could not be kept inline
     std::string message;
+    const BoltAssertSite* site = nullptr;
+    BoltOperand operands[2];
+
+    std::string describe() const;
 };
 struct BoltTest {
     private:
@@ -68,16 +115,24 @@ struct BoltTest {
   inline BoltTestResult getResult() { return result; }
   inline void setResult(BoltTestResult result) { this->result = result; }
   inline void addEvent(BoltTestEvent event) { events.push_back(event); }
-  inline void addEvent(std::string message, BoltTestResult result) { addEvent(BoltTestEvent{ result, message }); }
-  inline void flush() { events.clear(); contexts.clear(); result = BoltTestResult::CALCULATED;}
+  inline void addEvent(std::string message, BoltTestResult result) {
+      BoltTestEvent& event = events.emplace_back();
+      event.result = result;
+      event.message = std::move(message);
+  }
+  inline void flush() { events.clear(); contexts.clear(); silentPasses = 0; result = BoltTestResult::CALCULATED;}
   const char* name;
   const char* description;
   std::vector<BoltTestEvent> events;
+  // passing assertions not recorded as events while LOG_PASSED_ASSERTIONS is off
+  int silentPasses = 0;
   std::vector<std::string> contexts;
   std::function<BoltTestResult(BoltTest& test)> test;  
 };
 
 inline thread_local BoltTest* CURRENT_TEST = nullptr;
+// trace tracks of tests in parallel and isolated runs, above the small ids real threads get
+inline constexpr uint32_t BOLT_TEST_TRACK = 1u << 16;
 
 inline std::vector<BoltTest>& getTests() {
     static std::vector<BoltTest> tests;
@@ -149,113 +204,609 @@ inline void logWithColorNL(std::string msg,Utils::ColorUtils::ANSIIColor color,s
 
 #define _str(args ...) Utils::StringUtils::as_str(args)
 
-inline void runTests(std::ostream& out,std::ostream& timeProfiler = std::cout) {
-    if(TIME_PROFILER_IS_ON){
-        Utils::TimeUtils::Instrumentor::Get().BeginSession("BoltTest",timeProfiler);
-    }
-    BoltTestResult isCalculated;
-    int fail = 0;
+struct BoltTestTally {
     int pass = 0;
+    int fail = 0;
     int sus_fail = 0;
     int sus_pass = 0;
+    int regression = 0;
+
+    inline void add(BoltTestResult result) {
+        if (result == BoltTestResult::PASSED) pass++;
+        else if (result == BoltTestResult::SUS_PASS) sus_pass++;
+        else if (result == BoltTestResult::SUS_FAIL) sus_fail++;
+        else if (result == BoltTestResult::REGRESSION) regression++;
+        else fail++;
+    }
+    inline BoltTestTally& operator+=(const BoltTestTally& other) {
+        pass += other.pass;
+        fail += other.fail;
+        sus_fail += other.sus_fail;
+        sus_pass += other.sus_pass;
+        regression += other.regression;
+        return *this;
+    }
+};
 
-    for (auto& test : getTests()) {
-        test.flush();
-        logln(_str("NAME:: " , test.name), out);
-        logln(_str("DESC:: " , test.description), out);
+struct BoltTestSummary {
+    BoltTestTally tests;
+    BoltTestTally events;
+};
+
+enum class BoltOutputOrder {
+    REGISTRATION,
+    COMPLETION
+};
+
+inline void logTestHeader(const BoltTest& test, std::ostream& out) {
+    logln(_str("NAME:: " , test.name), out);
+    logln(_str("DESC:: " , test.description), out);
+    
+    log(test.name, out);
+    logWithColor(" test [START]",Utils::ColorUtils::BRIGHT_BLUE,out);
+    log("\n", out);
+}
+
+inline void logTestFooter(BoltTest& test, const BoltTestTally& tally, std::ostream& out) {
+    std::string resultStr = getResultName(test.getResult());
+    
+    log(test.name,out);
+
+    log(" pass:: ",out);
+    logWithColor(std::to_string(tally.pass),Utils::ColorUtils::GREEN,out);
+    log(" X fail:: ",out);
+    logWithColor(std::to_string(tally.fail + tally.regression),Utils::ColorUtils::RED,out);
+    log(" X sus_fail:: ",out);
+    logWithColor(std::to_string(tally.sus_fail),Utils::ColorUtils::BRIGHT_YELLOW,out);
+    log(" X sus_pass:: ",out);
+    logWithColor(std::to_string(tally.sus_pass),Utils::ColorUtils::BRIGHT_BLUE,out);
+    log(" = RESULT:: ",out);
+    logWithColor(resultStr,Utils::ColorUtils::getResultColor(test.getResult()),out);
+
+    log("\n",out);
+    for(auto& context : test.contexts){
+        logln(context,out);
+    }
+    log(test.name, out);
+    logWithColor(" test [END]",Utils::ColorUtils::BRIGHT_RED,out);
+}
+
+// runs a single test and writes its whole log to out, returns the event counts
+inline BoltTestTally runTest(BoltTest& test, std::ostream& out) {
+    BoltTestResult isCalculated;
+    BoltTestTally tally;
+
+    test.flush();
+    logTestHeader(test, out);
+
+
+    CURRENT_TEST = &test;
+    if(TIME_PROFILER_IS_ON){
+        PROFILE_SCOPE_CATEGORY(test.name, TEST);
+        isCalculated = test.test(test);
+    }else{
+        isCalculated = test.test(test);
+    }
+
+    for (auto& event : test.events) {
+        std::string resultStr = std::string("[") + getResultName(event.result) + "] ";
+        logWithColorNL(resultStr + event.describe(),Utils::ColorUtils::getResultColor(event.result), out);
+        tally.add(event.result);
+    }
+    tally.pass += test.silentPasses;
+    const int pass = tally.pass;
+    const int sus_fail = tally.sus_fail;
+    const int sus_pass = tally.sus_pass;
+    // a performance regression weighs like a failed assertion
+    const int fail = tally.fail + tally.regression;
+
+    if (isCalculated == BoltTestResult::CALCULATED) {
+        BoltTestResult result;
+        float confidence = 0.0f;
+        
+        int score = (pass * 2 + sus_pass) - (fail * 2 + sus_fail);
+        int totalWeight = pass * 2 + sus_pass + fail * 2 + sus_fail;
+        
+        if (totalWeight == 0) {
+            confidence = 50.0f;
+            result = BoltTestResult::SUS_PASS;
+        } else {
+            confidence = 50.0f + (100.0f * score) / (2.0f * totalWeight);
+            confidence = std::max(0.0f, std::min(100.0f, confidence));
+        
+            if (confidence <= 20.0f) result = BoltTestResult::FAILED;
+            else if (confidence <= 45.0f) result = BoltTestResult::SUS_FAIL;
+            else if (confidence < 55.0f) result = BoltTestResult::SUS_PASS;
+            else if (confidence < 80.0f) result = BoltTestResult::SUS_PASS;
+            else result = BoltTestResult::PASSED;
+        }
+
+        std::string bar = "";
+        for (int i = 0; i < 20; ++i) {
+            if (i < (int)confidence / 5) bar += '=';
+            else bar += ' ';
+        }
+        logWithColorNL("CONFIDENCE::[" + bar + "] " + std::to_string((int)confidence) + "%",Utils::ColorUtils::getResultColor(result),out);
         
-        log(test.name, out);
-        logWithColor(" test [START]",Utils::ColorUtils::BRIGHT_BLUE,out);
-        log("\n", out);
+        test.setResult(result);
+        } 
+    else {
+        logWithColorNL("[WARNING] Test is not calculated, calculated mode is recommended for better debugging!",Utils::ColorUtils::BRIGHT_YELLOW,out);
+        test.setResult(isCalculated);
+    }
 
+    logTestFooter(test, tally, out);
 
-        CURRENT_TEST = &test;
-        if(TIME_PROFILER_IS_ON){
-            PROFILE_SCOPE(test.name);
-            isCalculated = test.test(test);
-        }else{
-            isCalculated = test.test(test);
+    CURRENT_TEST = nullptr;
+    return tally;
+}
+
+// a test that throws is reported as FAILED with its footer, so the rest of the run and the summary go on
+inline BoltTestTally runTestReportingExceptions(BoltTest& test, std::ostream& out) {
+    try {
+        return runTest(test, out);
+    } catch (const std::exception& error) {
+        logWithColorNL(_str("[FAILED] test threw: ", error.what()), Utils::ColorUtils::RED, out);
+    } catch (...) {
+        logWithColorNL("[FAILED] test threw an unknown exception", Utils::ColorUtils::RED, out);
+    }
+    CURRENT_TEST = nullptr;
+    BoltTestTally tally;
+    test.setResult(BoltTestResult::FAILED);
+    tally.fail++;
+    logTestFooter(test, tally, out);
+    return tally;
+}
+
+struct BoltRunOptions {
+    // 0 = one per core
+    size_t jobs = 1;
+    BoltOutputOrder order = BoltOutputOrder::REGISTRATION;
+    // run tests in forked children, batch tests share one child, only on POSIX systems
+    bool isolate = false;
+    size_t batch = 1;
+    // per test, 0 disables it, only enforced in isolated mode
+    std::chrono::milliseconds timeout{ 0 };
+    // tests are dealt round robin over shardCount shards after filtering
+    size_t shardIndex = 0;
+    size_t shardCount = 1;
+    // comma separated globs with * and ?, a leading - excludes
+    std::string filter;
+};
+
+inline bool matchesGlob(std::string_view text, std::string_view pattern) {
+    size_t t = 0, p = 0;
+    size_t star = std::string_view::npos, resume = 0;
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+            ++t;
+            ++p;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            resume = t;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            t = ++resume;
+        } else {
+            return false;
         }
-        pass = 0;
-        fail = 0;
-        sus_fail = 0;
-        sus_pass = 0;
-
-        for (auto& event : test.events) {
-            std::string resultStr = std::string("[") + getResultName(event.result) + "] ";
-            logWithColorNL(resultStr + event.message,Utils::ColorUtils::getResultColor(event.result), out);
-
-            if (event.result == BoltTestResult::PASSED) pass++;
-            else if (event.result == BoltTestResult::SUS_PASS) sus_pass++;
-            else if (event.result == BoltTestResult::SUS_FAIL) sus_fail++;
-            else fail++;
+    }
+    while (p < pattern.size() && pattern[p] == '*') ++p;
+    return p == pattern.size();
+}
+
+inline bool matchesFilter(std::string_view name, std::string_view filter) {
+    bool hasPositive = false;
+    bool included = false;
+    while (!filter.empty()) {
+        const size_t comma = filter.find(',');
+        std::string_view pattern = filter.substr(0, comma);
+        filter = comma == std::string_view::npos ? std::string_view{} : filter.substr(comma + 1);
+        if (pattern.empty()) continue;
+        if (pattern.front() == '-') {
+            if (matchesGlob(name, pattern.substr(1))) return false;
+        } else {
+            hasPositive = true;
+            included = included || matchesGlob(name, pattern);
         }
+    }
+    return included || !hasPositive;
+}
 
-        if (isCalculated == BoltTestResult::CALCULATED) {
-            BoltTestResult result;
-            float confidence = 0.0f;
-            
-            int score = (pass * 2 + sus_pass) - (fail * 2 + sus_fail);
-            int totalWeight = pass * 2 + sus_pass + fail * 2 + sus_fail;
-            
-            if (totalWeight == 0) {
-                confidence = 50.0f;
-                result = BoltTestResult::SUS_PASS;
-            } else {
-                confidence = 50.0f + (100.0f * score) / (2.0f * totalWeight);
-                confidence = std::max(0.0f, std::min(100.0f, confidence));
-            
-                if (confidence <= 20.0f) result = BoltTestResult::FAILED;
-                else if (confidence <= 45.0f) result = BoltTestResult::SUS_FAIL;
-                else if (confidence < 55.0f) result = BoltTestResult::SUS_PASS;
-                else if (confidence < 80.0f) result = BoltTestResult::SUS_PASS;
-                else result = BoltTestResult::PASSED;
-            }
+// indices into getTests(), in registration order
+inline std::vector<size_t> selectTests(const BoltRunOptions& options) {
+    if (options.shardCount == 0 || options.shardIndex >= options.shardCount) {
+        throw std::invalid_argument(_str("invalid shard ", options.shardIndex, "/", options.shardCount));
+    }
+    std::vector<size_t> selection;
+    size_t matched = 0;
+    const auto& tests = getTests();
+    for (size_t i = 0; i < tests.size(); ++i) {
+        if (!matchesFilter(tests[i].name, options.filter)) continue;
+        if (matched++ % options.shardCount == options.shardIndex) selection.push_back(i);
+    }
+    return selection;
+}
+
+// keeps finished logs until every earlier test is written, not thread safe on its own
+class BoltOrderedOutput {
+  public:
+    BoltOrderedOutput(std::ostream& out, size_t count, BoltOutputOrder order): out(out), logs(count), done(count, false), order(order) {}
+
+    inline void finish(size_t position, std::string log) {
+        if (order == BoltOutputOrder::COMPLETION) {
+            out << log;
+            return;
+        }
+        logs[position] = std::move(log);
+        done[position] = true;
+        for (; written < logs.size() && done[written]; ++written) {
+            out << logs[written];
+            logs[written].clear();
+            logs[written].shrink_to_fit();
+        }
+    }
+
+  private:
+    std::ostream& out;
+    std::vector<std::string> logs;
+    std::vector<bool> done;
+    size_t written = 0;
+    BoltOutputOrder order;
+};
+
+inline void logSummary(const BoltTestSummary& summary, size_t count, std::ostream& out) {
+    log("\n", out);
+    log("SUMMARY:: tests:: " + std::to_string(count), out);
+    log(" pass:: ",out);
+    logWithColor(std::to_string(summary.tests.pass),Utils::ColorUtils::GREEN,out);
+    log(" X fail:: ",out);
+    logWithColor(std::to_string(summary.tests.fail),Utils::ColorUtils::RED,out);
+    log(" X sus_fail:: ",out);
+    logWithColor(std::to_string(summary.tests.sus_fail),Utils::ColorUtils::BRIGHT_YELLOW,out);
+    log(" X sus_pass:: ",out);
+    logWithColor(std::to_string(summary.tests.sus_pass),Utils::ColorUtils::BRIGHT_BLUE,out);
+    if (summary.tests.regression) {
+        log(" X regression:: ",out);
+        logWithColor(std::to_string(summary.tests.regression),Utils::ColorUtils::MAGENTA,out);
+    }
+    log("\n", out);
+}
+
+inline std::vector<size_t> allTests() {
+    std::vector<size_t> selection(getTests().size());
+    for (size_t i = 0; i < selection.size(); ++i) selection[i] = i;
+    return selection;
+}
+
+// every test in registration order on the calling thread
+inline BoltTestSummary runTests(std::ostream& out,std::ostream& timeProfiler = std::cout) {
+    if(TIME_PROFILER_IS_ON){
+        Utils::TimeUtils::Instrumentor::Get().BeginSession("BoltTest",timeProfiler);
+    }
+    BoltTestSummary summary;
+
+    for (auto& test : getTests()) {
+        summary.events += runTestReportingExceptions(test, out);
+        summary.tests.add(test.getResult());
+    }
+    if(TIME_PROFILER_IS_ON){
+        Utils::TimeUtils::Instrumentor::Get().EndSession();
+    }
+    logSummary(summary, getTests().size(), out);
+    return summary;
+}
 
-            std::string bar = "";
-            for (int i = 0; i < 20; ++i) {
-                if (i < (int)confidence / 5) bar += '=';
-                else bar += ' ';
+// runs the selected tests on jobs workers (0 = one per core), each test logs into its own buffer which is
+// written out in selection order, or as soon as the test finishes with BoltOutputOrder::COMPLETION
+inline BoltTestSummary runTestsParallel(const std::vector<size_t>& selection,size_t jobs,std::ostream& out,std::ostream& timeProfiler = std::cout,BoltOutputOrder order = BoltOutputOrder::REGISTRATION) {
+    auto& tests = getTests();
+    if (jobs == 0) jobs = std::max(1u, std::thread::hardware_concurrency());
+    jobs = std::max<size_t>(1, std::min(jobs, selection.size()));
+
+    if(TIME_PROFILER_IS_ON){
+        Utils::TimeUtils::Instrumentor::Get().BeginSession("BoltTest",timeProfiler);
+    }
+    BoltTestSummary summary;
+    BoltOrderedOutput output(out, selection.size(), order);
+    std::mutex outputMutex;
+    std::atomic<size_t> next{0};
+
+    auto worker = [&]() {
+        for (size_t position = next.fetch_add(1); position < selection.size(); position = next.fetch_add(1)) {
+            const size_t i = selection[position];
+            BoltTest& test = tests[i];
+            const uint32_t track = BOLT_TEST_TRACK + static_cast<uint32_t>(i);
+            Utils::TimeUtils::THREAD_TRACK = track;
+            if(TIME_PROFILER_IS_ON){
+                Utils::TimeUtils::Instrumentor::Get().NameTrack(track, test.name);
             }
-            logWithColorNL("CONFIDENCE::[" + bar + "] " + std::to_string((int)confidence) + "%",Utils::ColorUtils::getResultColor(result),out);
-            
-            test.setResult(result);
-            } 
-        else {
-            logWithColorNL("[WARNING] Test is not calculated, calculated mode is recommended for better debugging!",Utils::ColorUtils::BRIGHT_YELLOW,out);
-            test.setResult(isCalculated);
+            std::ostringstream buffer;
+            const BoltTestTally tally = runTestReportingExceptions(test, buffer);
+            Utils::TimeUtils::THREAD_TRACK = 0;
+
+            std::lock_guard lock(outputMutex);
+            summary.events += tally;
+            summary.tests.add(test.getResult());
+            output.finish(position, std::move(buffer).str());
         }
+    };
 
-        std::string resultStr = getResultName(test.getResult());
-        
-        log(test.name,out);
-
-        log(" pass:: ",out);
-        logWithColor(std::to_string(pass),Utils::ColorUtils::GREEN,out);
-        log(" X fail:: ",out);
-        logWithColor(std::to_string(fail),Utils::ColorUtils::RED,out);
-        log(" X sus_fail:: ",out);
-        logWithColor(std::to_string(sus_fail),Utils::ColorUtils::BRIGHT_YELLOW,out);
-        log(" X sus_pass:: ",out);
-        logWithColor(std::to_string(sus_pass),Utils::ColorUtils::BRIGHT_BLUE,out);
-        log(" = RESULT:: ",out);
-        logWithColor(resultStr,Utils::ColorUtils::getResultColor(test.getResult()),out);
+    {
+        std::vector<std::jthread> workers;
+        workers.reserve(jobs - 1);
+        for (size_t i = 1; i < jobs; ++i) workers.emplace_back(worker);
+        worker();
+    }
+    out.flush();
 
-        
+    if(TIME_PROFILER_IS_ON){
+        Utils::TimeUtils::Instrumentor::Get().EndSession();
+    }
+    logSummary(summary, selection.size(), out);
+    return summary;
+}
+
+inline BoltTestSummary runTestsParallel(size_t jobs,std::ostream& out,std::ostream& timeProfiler = std::cout,BoltOutputOrder order = BoltOutputOrder::REGISTRATION) {
+    return runTestsParallel(allTests(), jobs, out, timeProfiler, order);
+}
+
+#if BOLT_CAN_FORK
+// one record per finished test, followed by logSize bytes of log
+struct BoltChildRecord {
+    uint32_t position;
+    int32_t result;
+    BoltTestTally tally;
+    long long start, end;
+    uint64_t logSize;
+};
+
+inline bool writeAll(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size) {
+        const ssize_t written = ::write(fd, bytes, size);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+[[noreturn]] inline void runChildBatch(const std::vector<size_t>& batch, int fd) {
+    // the parent owns the trace, it is written from the records instead
+    Utils::TimeUtils::Instrumentor::Get().AbandonSession();
+    for (size_t position = 0; position < batch.size(); ++position) {
+        BoltTest& test = getTests()[batch[position]];
+        std::ostringstream buffer;
+        BoltChildRecord record{};
+        record.position = static_cast<uint32_t>(position);
+        record.start = Utils::TimeUtils::traceNow();
+        record.tally = runTestReportingExceptions(test, buffer);
+        record.end = Utils::TimeUtils::traceNow();
+        record.result = static_cast<int32_t>(test.getResult());
+        const std::string log = std::move(buffer).str();
+        record.logSize = log.size();
+        if (!writeAll(fd, &record, sizeof(record)) || !writeAll(fd, log.data(), log.size())) break;
+    }
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+    ::_exit(0);
+}
+
+// forks up to jobs children at a time, a crashed or timed out test is reported as failed and the
+// rest of its batch continues in a fresh child
+inline BoltTestSummary runTestsIsolated(const std::vector<size_t>& selection,const BoltRunOptions& options,std::ostream& out,std::ostream& timeProfiler = std::cout) {
+    using Clock = std::chrono::steady_clock;
+    struct Child {
+        pid_t pid;
+        int fd;
+        std::vector<size_t> batch;
+        size_t finished = 0;
+        std::string received;
+        Clock::time_point testStart;
+        bool timedOut = false;
+    };
+
+    auto& tests = getTests();
+    size_t jobs = options.jobs == 0 ? std::max(1u, std::thread::hardware_concurrency()) : options.jobs;
+    const size_t batchSize = std::max<size_t>(1, options.batch);
+
+    if(TIME_PROFILER_IS_ON){
+        Utils::TimeUtils::Instrumentor::Get().BeginSession("BoltTest",timeProfiler);
+    }
+    BoltTestSummary summary;
+    BoltOrderedOutput output(out, selection.size(), options.order);
+    std::vector<size_t> positions(tests.size());
+    for (size_t position = 0; position < selection.size(); ++position) positions[selection[position]] = position;
+
+    std::deque<std::vector<size_t>> queue;
+    for (size_t first = 0; first < selection.size(); first += batchSize) {
+        queue.emplace_back(selection.begin() + first, selection.begin() + std::min(selection.size(), first + batchSize));
+    }
+    std::vector<Child> children;
 
-        log("\n",out);
-        for(auto& context : test.contexts){
-            logln(context,out);
+    auto finish = [&](size_t index, BoltTestResult result, const BoltTestTally& tally, std::string log, long long start, long long end) {
+        BoltTest& test = tests[index];
+        test.setResult(result);
+        summary.events += tally;
+        summary.tests.add(result);
+        if(TIME_PROFILER_IS_ON){
+            const uint32_t track = BOLT_TEST_TRACK + static_cast<uint32_t>(index);
+            Utils::TimeUtils::Instrumentor::Get().NameTrack(track, test.name);
+            Utils::TimeUtils::Instrumentor::Get().WriteProfile({ test.name, start, end, track });
+        }
+        output.finish(positions[index], std::move(log));
+    };
+
+    auto spawn = [&](std::vector<size_t> batch) {
+        int fds[2];
+        if (::pipe(fds) != 0) throw std::system_error(errno, std::generic_category(), "pipe");
+        // anything still buffered would be written a second time by the child, the trace collector
+        // may share these streams so it is held off until the fork is done
+        auto traceOutput = Utils::TimeUtils::Instrumentor::Get().HoldOutput();
+        out.flush();
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(nullptr);
+        const pid_t pid = ::fork();
+        if (pid < 0) throw std::system_error(errno, std::generic_category(), "fork");
+        if (pid == 0) {
+            ::close(fds[0]);
+            runChildBatch(batch, fds[1]);
+        }
+        traceOutput.unlock();
+        ::close(fds[1]);
+        children.push_back(Child{ pid, fds[0], std::move(batch), 0, {}, Clock::now(), false });
+    };
+
+    auto consume = [&](Child& child) {
+        while (child.received.size() >= sizeof(BoltChildRecord)) {
+            BoltChildRecord record;
+            std::memcpy(&record, child.received.data(), sizeof(record));
+            if (child.received.size() < sizeof(record) + record.logSize) break;
+            std::string log = child.received.substr(sizeof(record), record.logSize);
+            child.received.erase(0, sizeof(record) + record.logSize);
+            finish(child.batch[record.position], static_cast<BoltTestResult>(record.result), record.tally, std::move(log), record.start, record.end);
+            child.finished = record.position + 1;
+            child.testStart = Clock::now();
+        }
+    };
+
+    auto reap = [&](Child& child) {
+        ::close(child.fd);
+        int status = 0;
+        while (::waitpid(child.pid, &status, 0) < 0 && errno == EINTR) {}
+        if (child.finished >= child.batch.size()) return;
+
+        const size_t index = child.batch[child.finished];
+        BoltTest& test = tests[index];
+        std::string reason;
+        if (child.timedOut) reason = _str("timed out after ", options.timeout.count(), " ms");
+        else if (WIFSIGNALED(status)) reason = _str("crashed with signal ", WTERMSIG(status), " (", ::strsignal(WTERMSIG(status)), ")");
+        else reason = _str("exited with code ", WEXITSTATUS(status), " before reporting");
+
+        test.flush();
+        test.setResult(BoltTestResult::FAILED);
+        BoltTestTally tally;
+        tally.fail = 1;
+        std::ostringstream buffer;
+        logTestHeader(test, buffer);
+        logWithColorNL("[FAILED] " + reason, Utils::ColorUtils::RED, buffer);
+        logTestFooter(test, tally, buffer);
+        const long long end = Utils::TimeUtils::traceNow();
+        const long long start = end - std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - child.testStart).count();
+        finish(index, BoltTestResult::FAILED, tally, std::move(buffer).str(), start, end);
+
+        if (child.finished + 1 < child.batch.size()) {
+            queue.emplace_front(child.batch.begin() + child.finished + 1, child.batch.end());
+        }
+    };
+
+    while (!queue.empty() || !children.empty()) {
+        while (children.size() < jobs && !queue.empty()) {
+            spawn(std::move(queue.front()));
+            queue.pop_front();
         }
-        log(test.name, out);
-        logWithColor(" test [END]",Utils::ColorUtils::BRIGHT_RED,out);
 
-        CURRENT_TEST = nullptr;
+        std::vector<pollfd> fds;
+        int wait = -1;
+        const auto now = Clock::now();
+        for (const Child& child : children) {
+            fds.push_back(pollfd{ child.fd, POLLIN, 0 });
+            if (options.timeout.count() > 0) {
+                const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(child.testStart + options.timeout - now).count();
+                const int leftMs = static_cast<int>(std::max<long long>(0, left));
+                wait = wait < 0 ? leftMs : std::min(wait, leftMs);
+            }
+        }
+        if (::poll(fds.data(), fds.size(), wait) < 0 && errno != EINTR) throw std::system_error(errno, std::generic_category(), "poll");
+
+        std::vector<Child> running;
+        for (size_t k = 0; k < children.size(); ++k) {
+            Child& child = children[k];
+            bool closed = false;
+            if (fds[k].revents & (POLLIN | POLLHUP | POLLERR)) {
+                char chunk[1 << 16];
+                const ssize_t got = ::read(child.fd, chunk, sizeof(chunk));
+                if (got > 0) {
+                    child.received.append(chunk, got);
+                    consume(child);
+                } else if (got == 0 || errno != EINTR) {
+                    closed = true;
+                }
+            }
+            if (!closed && options.timeout.count() > 0 && Clock::now() - child.testStart >= options.timeout) {
+                ::kill(child.pid, SIGKILL);
+                child.timedOut = true;
+                closed = true;
+            }
+            if (closed) reap(child);
+            else running.push_back(std::move(child));
+        }
+        children = std::move(running);
     }
+    out.flush();
+
     if(TIME_PROFILER_IS_ON){
         Utils::TimeUtils::Instrumentor::Get().EndSession();
     }
+    logSummary(summary, selection.size(), out);
+    return summary;
+}
+#endif
+
+inline BoltTestSummary runTests(const BoltRunOptions& options,std::ostream& out,std::ostream& timeProfiler = std::cout) {
+    const std::vector<size_t> selection = selectTests(options);
+#if BOLT_CAN_FORK
+    if (options.isolate) return runTestsIsolated(selection, options, out, timeProfiler);
+#else
+    if (options.isolate) {
+        logWithColorNL("[WARNING] Isolated mode needs fork, running the tests in process",Utils::ColorUtils::BRIGHT_YELLOW,out);
+    }
+#endif
+    return runTestsParallel(selection, options.jobs, out, timeProfiler, options.order);
+}
 
+// --jobs=n --isolate --batch=n --timeout=ms --shard=i/n --filter=globs --completion-order
+inline BoltRunOptions parseTestOptions(int argc, char** argv) {
+    BoltRunOptions options;
+    auto number = [](std::string_view flag, std::string_view value) -> size_t {
+        size_t parsed = 0;
+        const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), parsed);
+        if (error != std::errc() || end != value.data() + value.size()) {
+            throw std::invalid_argument(_str("invalid value for ", flag, ": ", value));
+        }
+        return parsed;
+    };
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+        const size_t equals = argument.find('=');
+        const std::string_view flag = argument.substr(0, equals);
+        const std::string_view value = equals == std::string_view::npos ? std::string_view{} : argument.substr(equals + 1);
+        if (flag == "--jobs") options.jobs = number(flag, value);
+        else if (flag == "--isolate") options.isolate = true;
+        else if (flag == "--batch") options.batch = number(flag, value);
+        else if (flag == "--timeout") options.timeout = std::chrono::milliseconds(number(flag, value));
+        else if (flag == "--filter") options.filter = std::string(value);
+        else if (flag == "--completion-order") options.order = BoltOutputOrder::COMPLETION;
+        else if (flag == "--shard") {
+            const size_t slash = value.find('/');
+            if (slash == std::string_view::npos) throw std::invalid_argument(_str("expected --shard=i/n, got ", argument));
+            options.shardIndex = number(flag, value.substr(0, slash));
+            options.shardCount = number(flag, value.substr(slash + 1));
+            if (options.shardCount == 0 || options.shardIndex >= options.shardCount) throw std::invalid_argument(_str("invalid shard ", value));
+        }
+        else throw std::invalid_argument(_str("unknown option ", argument));
+    }
+    return options;
+}
+
+// exit code for a test binary, 1 when anything failed or regressed
+inline int runTestsMain(int argc, char** argv, std::ostream& out = std::cout, std::ostream& timeProfiler = std::cout) {
+    const BoltTestSummary summary = runTests(parseTestOptions(argc, argv), out, timeProfiler);
+    return summary.tests.fail + summary.tests.regression ? 1 : 0;
 }
 
 #define BOLT_TEST(NAME, DESCRIPTION, FUNC) \
@@ -291,17 +842,66 @@ inline std::string to_string_helper(const char* value) {
     return value ? std::string(value) : "nullptr";
 }
 
+inline std::string formatAssertion(const BoltAssertSite& site, const std::string& a, const std::string& b) {
+    return std::string{site.lhs} + " " + site.op + " " + site.rhs +
+        " (" + a + " ?= " + b + ")" +
+        " at " + site.file + ":" + std::to_string(site.line);
+}
+
+template<typename T>
+std::string formatOperand(const void* value) {
+    return to_string_helper(*static_cast<const T*>(value));
+}
+
+template<typename T>
+constexpr bool isCharacter = std::is_same_v<T, char> || std::is_same_v<T, signed char> ||
+    std::is_same_v<T, unsigned char> || std::is_same_v<T, char8_t>;
+
+// only values whose text can not change before the log is written: numbers, enums and pointers printed as
+// addresses. views, spans and char pointers are formatted through memory that may be gone by then
+template<typename T>
+constexpr bool isInlineOperand = (std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_null_pointer_v<T> ||
+    (std::is_pointer_v<T> && !isCharacter<std::remove_cv_t<std::remove_pointer_t<T>>>)) &&
+    sizeof(T) <= sizeof(BoltOperand::bytes) && alignof(T) <= alignof(BoltOperand);
+
+template<typename T>
+inline bool storeOperand(BoltOperand& operand, const T& value) {
+    if constexpr (isInlineOperand<T>) {
+        std::memcpy(operand.bytes, &value, sizeof(T));
+        operand.format = &formatOperand<T>;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+inline std::string BoltTestEvent::describe() const {
+    if (!site || !operands[0].format) return message;
+    return formatAssertion(*site, operands[0].format(operands[0].bytes), operands[1].format(operands[1].bytes));
+}
+
+template<typename A, typename B>
+inline void recordAssertion(const BoltAssertSite& site, bool passed, const A& a, const B& b) {
+    BoltTest* test = CURRENT_TEST;
+    if (passed && !LOG_PASSED_ASSERTIONS) {
+        test->silentPasses++;
+        return;
+    }
+    BoltTestEvent& event = test->events.emplace_back();
+    event.result = passed ? BoltTestResult::PASSED : BoltTestResult::FAILED;
+    event.site = &site;
+    // failures are formatted right away, only passing assertions wait for the log
+    if (passed && storeOperand(event.operands[0], a) && storeOperand(event.operands[1], b)) return;
+    event.operands[0].format = nullptr;
+    event.message = formatAssertion(site, to_string_helper(a), to_string_helper(b));
+}
+
 #define BOLT_ASSERT_IMPL(OP, A, B, FILE, LINE) \
     do { \
-        auto a_val = (A); \
-        auto b_val = (B); \
-        bool result = (a_val) OP (b_val); \
-        BoltTestEvent event; \
-        event.result = result ? BoltTestResult::PASSED : BoltTestResult::FAILED; \
-        event.message = std::string{#A} + " " #OP " " + std::string{#B} + \
-            " (" + to_string_helper(a_val) + " ?= " + to_string_helper(b_val) + ")" + \
-            " at " + std::string{FILE} + ":" + std::to_string(LINE); \
-        CURRENT_TEST->addEvent(event); \
+        static constexpr BoltAssertSite bolt_site{ #A, #OP, #B, FILE, LINE }; \
+        const std::decay_t<decltype(A)>& a_val = (A); \
+        const std::decay_t<decltype(B)>& b_val = (B); \
+        recordAssertion(bolt_site, static_cast<bool>((a_val) OP (b_val)), a_val, b_val); \
     } while(false)
 
 #define ADD_CONTEXT(CONTEXT) do { \
@@ -5,12 +5,71 @@
 #include <thread>
 #include <iostream>
 #include <mutex>
+#include <atomic>
+#include <array>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <condition_variable>
+#include <stop_token>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <source_location>
+#include <type_traits>
+#if defined(__linux__)
+#define PROFILE_CAN_COUNT 1
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#define PROFILE_CAN_COUNT 0
+#endif
 inline int GLOBAL_DEBUG_N = -1;
 #define _PROFILE_SCOPE(name, debugn) \
     if (GLOBAL_DEBUG_N == debugn) Utils::TimeUtils::ScopeTimer timer##__LINE__(name)
 
-#define PROFILE_SCOPE(name) Utils::TimeUtils::ScopeTimer timer##__LINE__(name)
-#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+// categories built into the binary, scopes outside this mask compile to nothing
+#ifndef PROFILE_COMPILED_CATEGORIES
+#define PROFILE_COMPILED_CATEGORIES 0xFFFFFFFFu
+#endif
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_COMPILED(category) \
+    ((Utils::TimeUtils::ProfileCategory::category & (PROFILE_COMPILED_CATEGORIES)) != 0)
+
+// string literals are interned once per call site, any other name once per enabled scope
+#define PROFILE_SCOPE_CATEGORY(name, category) \
+    Utils::TimeUtils::ProfileScope<PROFILE_COMPILED(category)> PROFILE_CONCAT(profileScope, __LINE__)( \
+        Utils::TimeUtils::ProfileCategory::category, [&]() -> uint32_t { \
+            if constexpr (Utils::TimeUtils::isConstCharArray<std::remove_reference_t<decltype(name)>>) { \
+                static const uint32_t id = Utils::TimeUtils::TraceNames::Get().intern(name); \
+                return id; \
+            } else { \
+                return Utils::TimeUtils::TraceNames::Get().intern(name); \
+            } \
+        })
+// the location is captured outside the lambda, inside it would name the lambda itself
+#define PROFILE_FUNCTION_CATEGORY(category) \
+    Utils::TimeUtils::ProfileScope<PROFILE_COMPILED(category)> PROFILE_CONCAT(profileScope, __LINE__)( \
+        Utils::TimeUtils::ProfileCategory::category, [location = std::source_location::current()]() -> uint32_t { \
+            static const uint32_t id = Utils::TimeUtils::TraceNames::Get().intern(location.function_name()); \
+            return id; \
+        })
+
+#define PROFILE_SCOPE(name) PROFILE_SCOPE_CATEGORY(name, DEFAULT)
+#define PROFILE_FUNCTION() PROFILE_FUNCTION_CATEGORY(DEFAULT)
 #define SCOPE(name) \
     if (int _scope_flag = 0) {} else for (Utils::TimeUtils::ScopeTimer timer__LINE__(name); !_scope_flag; _scope_flag = 1)
 
@@ -23,96 +82,1128 @@ inline int GLOBAL_DEBUG_N = -1;
         PROFILE_SCOPE(#name);
 
 namespace Utils::TimeUtils {
+    // trace track for the current thread, 0 falls back to the thread's own id
+    inline thread_local uint32_t THREAD_TRACK = 0;
+
+    // small ids handed out in the order threads first record something, stable for the process
+    inline uint32_t threadID() {
+        static std::atomic<uint32_t> next{ 1 };
+        thread_local const uint32_t id = next.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
+
+    inline uint32_t currentTrack() {
+        if (THREAD_TRACK) return THREAD_TRACK;
+        return threadID();
+    }
+
+    // steady clock nanoseconds, the time base of every trace
+    inline long long traceNow() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct CounterValues {
+        uint64_t cycles = 0;
+        uint64_t instructions = 0;
+        uint64_t cacheMisses = 0;
+        uint64_t branchMisses = 0;
+    };
+
+    inline CounterValues operator-(const CounterValues& end, const CounterValues& start) {
+        return { end.cycles - start.cycles, end.instructions - start.instructions,
+            end.cacheMisses - start.cacheMisses, end.branchMisses - start.branchMisses };
+    }
+
+    // scopes and timers read hardware counters while this is on, see setProfileCounters
+    inline std::atomic<bool> PROFILE_COUNTERS{ false };
+
+    // user space hardware counters of the calling thread, opened on first use as one perf group
+    // so all four count over the same interval, unavailable when perf access is restricted
+    class PerfCounters {
+        public:
+            static PerfCounters& Local() {
+                thread_local PerfCounters counters;
+                return counters;
+            }
+
+            bool available() const { return fds[0] >= 0; }
+            // why the counters could not be opened, empty when they were
+            const std::string& error() const { return error_; }
+
+            // false leaves values untouched, counters the hardware lacks stay zero
+            bool read(CounterValues& values) {
+#if PROFILE_CAN_COUNT
+                if (!available()) return false;
+                uint64_t counts[COUNTERS] = {};
+                if (!readMapped(counts) && !readGroup(counts)) return false;
+                values = { counts[0], counts[1], counts[2], counts[3] };
+                return true;
+#else
+                static_cast<void>(values);
+                return false;
+#endif
+            }
+
+            PerfCounters(const PerfCounters&) = delete;
+            PerfCounters& operator=(const PerfCounters&) = delete;
+
+            ~PerfCounters() {
+#if PROFILE_CAN_COUNT
+                for (size_t i = 0; i < COUNTERS; ++i) {
+                    if (pages[i]) munmap(pages[i], pageSize);
+                    if (fds[i] >= 0) close(fds[i]);
+                }
+#endif
+            }
+
+        private:
+            static constexpr size_t COUNTERS = 4;
+
+#if PROFILE_CAN_COUNT
+            PerfCounters() {
+                static constexpr uint64_t configs[COUNTERS] = {
+                    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+                };
+                pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+                for (size_t i = 0; i < COUNTERS; ++i) {
+                    perf_event_attr attr{};
+                    attr.size = sizeof(attr);
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = configs[i];
+                    attr.read_format = PERF_FORMAT_GROUP;
+                    // user space only, which perf_event_paranoid 2 still allows
+                    attr.exclude_kernel = 1;
+                    attr.exclude_hv = 1;
+                    const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, i ? fds[0] : -1, 0));
+                    if (fd < 0) {
+                        // without a leader there is nothing to count, a missing member just reads zero
+                        if (i == 0) {
+                            error_ = open_error("perf_event_open");
+                            return;
+                        }
+                        continue;
+                    }
+                    fds[i] = fd;
+                    slots[i] = groupSize++;
+                    void* page = mmap(nullptr, pageSize, PROT_READ, MAP_SHARED, fd, 0);
+                    if (page != MAP_FAILED) pages[i] = static_cast<perf_event_mmap_page*>(page);
+                }
+            }
+
+            static std::string open_error(const char* call) {
+                const int code = errno;
+                std::string reason = std::string(call) + ": " + std::strerror(code);
+                if (code == EACCES || code == EPERM) reason += ", see /proc/sys/kernel/perf_event_paranoid";
+                return reason;
+            }
+
+            // rdpmc straight from user space, no system call, needs the kernel to grant cap_user_rdpmc
+            bool readMapped(uint64_t* counts) {
+#if defined(__x86_64__) || defined(__i386__)
+                for (size_t i = 0; i < COUNTERS; ++i) {
+                    if (fds[i] < 0) continue;
+                    if (!pages[i]) return false;
+                    const volatile perf_event_mmap_page* page = pages[i];
+                    uint32_t sequence;
+                    do {
+                        sequence = page->lock;
+                        std::atomic_signal_fence(std::memory_order_acquire);
+                        const uint32_t index = page->index;
+                        // index 0 while the group is not on a cpu
+                        if (!page->cap_user_rdpmc || !index) return false;
+                        const uint16_t width = page->pmc_width;
+                        int64_t pmc = static_cast<int64_t>(__builtin_ia32_rdpmc(static_cast<int>(index - 1)));
+                        pmc = static_cast<int64_t>(static_cast<uint64_t>(pmc) << (64 - width)) >> (64 - width);
+                        counts[i] = static_cast<uint64_t>(page->offset + pmc);
+                        std::atomic_signal_fence(std::memory_order_acquire);
+                    } while (page->lock != sequence);
+                }
+                return true;
+#else
+                static_cast<void>(counts);
+                return false;
+#endif
+            }
+
+            // one read of the leader returns every member, in the order they joined
+            bool readGroup(uint64_t* counts) {
+                uint64_t data[1 + COUNTERS] = {};
+                if (::read(fds[0], data, sizeof(data)) < static_cast<ssize_t>(sizeof(uint64_t) * (1 + groupSize))) return false;
+                for (size_t i = 0; i < COUNTERS; ++i) {
+                    if (fds[i] >= 0) counts[i] = data[1 + slots[i]];
+                }
+                return true;
+            }
+
+            int fds[COUNTERS] = { -1, -1, -1, -1 };
+            size_t slots[COUNTERS] = {};
+            size_t groupSize = 0;
+            perf_event_mmap_page* pages[COUNTERS] = {};
+            size_t pageSize = 0;
+#else
+            PerfCounters() : error_("hardware counters need Linux perf_event_open") {}
+
+            int fds[COUNTERS] = { -1, -1, -1, -1 };
+#endif
+            std::string error_;
+    };
+
+    // turns counter reads on for scopes and timers, false when the calling thread cannot count,
+    // in which case events are still recorded, just without counters
+    inline bool setProfileCounters(bool on) {
+        PROFILE_COUNTERS.store(on, std::memory_order_relaxed);
+        return !on || PerfCounters::Local().available();
+    }
+
+    inline bool readProfileCounters(CounterValues& values) {
+        return PROFILE_COUNTERS.load(std::memory_order_relaxed) && PerfCounters::Local().read(values);
+    }
+
     struct ProfileResult {
         std::string name;
+        // nanoseconds on the traceNow() clock
         long long start, end;
         uint32_t threadID;
+        // differences over the timed interval, only meaningful when counted
+        CounterValues counters{};
+        bool counted = false;
+    };
+
+    enum class TraceFormat {
+        // Chrome traceEvents, readable by chrome://tracing and Perfetto
+        JSON,
+        // varint records with a name table, see tools/trace_to_json.py
+        BINARY
+    };
+
+    // binary layout: "BOLTTRC" 0, u32 version, u32 flags, then records starting with a tag byte,
+    // every integer after the header is a LEB128 varint, start times are zigzag deltas to the previous event
+    inline constexpr char BINARY_TRACE_MAGIC[8] = { 'B', 'O', 'L', 'T', 'T', 'R', 'C', 0 };
+    inline constexpr uint32_t BINARY_TRACE_VERSION = 1;
+    enum class TraceRecord : uint8_t {
+        END = 0,
+        // id, length, bytes
+        NAME = 1,
+        // name id, tid, start delta, duration
+        EVENT = 2,
+        // tid, length, bytes
+        TRACK_NAME = 3,
+        // count
+        DROPPED = 4,
+        // name id, tid, start delta, duration, cycles, instructions, cache misses, branch misses
+        COUNTED_EVENT = 5
+    };
+
+    // what a thread records per scope, the name lives in TraceNames
+    struct TraceEvent {
+        uint32_t nameID;
+        uint32_t threadID;
+        long long start, end;
+    };
+
+    // scopes timed while PROFILE_COUNTERS was on, kept apart so plain events stay small
+    struct CountedTraceEvent {
+        TraceEvent event;
+        CounterValues counters;
+    };
+
+    class TraceNames {
+        public:
+            static TraceNames& Get() {
+                static TraceNames instance;
+                return instance;
+            }
+
+            // every thread keeps its own cache so a known name never touches the lock
+            uint32_t intern(const std::string& name) {
+                thread_local std::unordered_map<std::string, uint32_t> cache;
+                auto cached = cache.find(name);
+                if (cached != cache.end()) return cached->second;
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto found = ids.find(name);
+                uint32_t id;
+                if (found != ids.end()) {
+                    id = found->second;
+                } else {
+                    id = static_cast<uint32_t>(names.size());
+                    names.push_back(name);
+                    ids.emplace(names.back(), id);
+                }
+                cache.emplace(name, id);
+                return id;
+            }
+
+            // appends the names from first on to out
+            void copy(uint32_t first, std::vector<std::string>& out) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (size_t i = first; i < names.size(); ++i) out.push_back(names[i]);
+            }
+
+        private:
+            std::mutex mutex_;
+            std::deque<std::string> names;
+            std::unordered_map<std::string_view, uint32_t> ids;
     };
+
+    // written by its thread only and drained by the collector, full rings drop instead of blocking
+    template<typename Event, size_t Capacity>
+    class BasicTraceRing {
+        public:
+            static constexpr size_t CAPACITY = Capacity;
+
+            bool push(const Event& event) {
+                const size_t head = head_.load(std::memory_order_relaxed);
+                if (head - cachedTail == CAPACITY) {
+                    cachedTail = tail_.load(std::memory_order_acquire);
+                    if (head - cachedTail == CAPACITY) {
+                        dropped.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                }
+                events[head & (CAPACITY - 1)] = event;
+                head_.store(head + 1, std::memory_order_release);
+                return true;
+            }
+
+            template<typename Consumer>
+            size_t drain(Consumer&& consumer) {
+                size_t tail = tail_.load(std::memory_order_relaxed);
+                const size_t head = head_.load(std::memory_order_acquire);
+                const size_t count = head - tail;
+                for (; tail != head; ++tail) consumer(events[tail & (CAPACITY - 1)]);
+                tail_.store(tail, std::memory_order_release);
+                return count;
+            }
+
+            std::atomic<bool> retired{ false };
+            std::atomic<uint64_t> dropped{ 0 };
+
+        private:
+            alignas(64) std::atomic<size_t> head_{ 0 };
+            size_t cachedTail = 0;
+            alignas(64) std::atomic<size_t> tail_{ 0 };
+            std::array<Event, CAPACITY> events;
+    };
+
+    using TraceRing = BasicTraceRing<TraceEvent, 1 << 14>;
+    // created by a thread on its first counted event only
+    using CountedTraceRing = BasicTraceRing<CountedTraceEvent, 1 << 12>;
+
+    // marks the rings retired when their thread exits, the collector frees them once drained
+    struct TraceRingHandle {
+        std::shared_ptr<TraceRing> ring;
+        std::shared_ptr<CountedTraceRing> counted;
+        ~TraceRingHandle() {
+            if (ring) ring->retired.store(true, std::memory_order_release);
+            if (counted) counted->retired.store(true, std::memory_order_release);
+        }
+    };
+    inline thread_local TraceRingHandle TRACE_RING;
+
+    // drain period of the collector thread
+    inline std::chrono::milliseconds TRACE_FLUSH_INTERVAL{ 10 };
+    // stream buffer of a file session, the collector's batches reach the disk in writes this large
+    inline size_t TRACE_WRITE_BUFFER = 1 << 20;
+
+    // limits of one file of a file session, zero is unlimited, checked after every collector batch
+    struct TraceRotation {
+        uint64_t maxBytes = 0;
+        std::chrono::seconds maxAge{ 0 };
+        // older files are deleted once this many exist, zero keeps them all
+        size_t maxFiles = 0;
+    };
+
+    namespace ProfileCategory {
+        enum : uint32_t {
+            DEFAULT = 1u << 0,
+            TOKENIZER = 1u << 1,
+            EXPRESSION = 1u << 2,
+            IO = 1u << 3,
+            TEST = 1u << 4,
+            ALL = 0xFFFFFFFFu
+        };
+    }
+
+    enum ProfileSink : uint32_t {
+        TRACE_SINK = 1u << 0,
+        AGGREGATE_SINK = 1u << 1
+    };
+
+    inline std::atomic<uint32_t> PROFILE_CATEGORIES{ ProfileCategory::ALL };
+    inline std::atomic<uint32_t> PROFILE_SINKS{ 0 };
+    // categories enabled at runtime and zero while nothing listens, the only thing a scope reads
+    inline std::atomic<uint32_t> ACTIVE_PROFILE_CATEGORIES{ 0 };
+
+    // recomputed until neither input moved underneath, so racing setters cannot leave a stale mask
+    inline void refreshProfileCategories() {
+        for (;;) {
+            const uint32_t sinks = PROFILE_SINKS.load();
+            const uint32_t categories = PROFILE_CATEGORIES.load();
+            ACTIVE_PROFILE_CATEGORIES.store(sinks ? categories : 0);
+            if (PROFILE_SINKS.load() == sinks && PROFILE_CATEGORIES.load() == categories) return;
+        }
+    }
+
+    inline void setProfileCategories(uint32_t categories) {
+        PROFILE_CATEGORIES.store(categories);
+        refreshProfileCategories();
+    }
+
+    inline void setProfileSink(ProfileSink sink, bool on) {
+        if (on) PROFILE_SINKS.fetch_or(sink);
+        else PROFILE_SINKS.fetch_and(~static_cast<uint32_t>(sink));
+        refreshProfileCategories();
+    }
     
+    // writes text as the inside of a JSON string, escaping quotes, backslashes and control characters
+    inline void writeJsonEscaped(std::ostream& out, std::string_view text) {
+        size_t start = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            const unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c != '"' && c != '\\' && c >= 0x20) continue;
+            out.write(text.data() + start, static_cast<std::streamsize>(i - start));
+            if (c == '"' || c == '\\') {
+                out << '\\' << static_cast<char>(c);
+            } else {
+                static constexpr char hex[] = "0123456789abcdef";
+                const char code[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+                out.write(code, sizeof(code));
+            }
+            start = i + 1;
+        }
+        out.write(text.data() + start, static_cast<std::streamsize>(text.size() - start));
+    }
+
     class Instrumentor {
         public:
             static Instrumentor& Get() {
                 static Instrumentor instance;
                 return instance;
             }
+
+            // a session still open at exit is finished so the trace stays valid
+            ~Instrumentor() {
+                EndSession();
+            }
         
-            void BeginSession(const std::string& name, std::ostream& out) {
-                std::lock_guard<std::mutex> lock(mutex_);
-                output = &out;
-                *output << "{\"otherData\": {},\"traceEvents\":[";
-                sessionActive = true;
+            void BeginSession(const std::string& name, std::ostream& out, TraceFormat traceFormat = TraceFormat::JSON) {
+                // leftovers of a scope that raced the end of the previous session
+                DrainAll(nullptr);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    output = &out;
+                    sessionName = name;
+                    format = traceFormat;
+                    trackNames.clear();
+                    WriteHeader();
+                }
+                StartCollector();
+            }
+
+            // writes to path through a large buffer, with limits the session continues in path.1.ext,
+            // path.2.ext and so on, every file a complete trace of its own
+            void BeginSession(const std::string& name, const std::string& path, TraceFormat traceFormat = TraceFormat::JSON, TraceRotation limits = {}) {
+                DrainAll(nullptr);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    basePath = path;
+                    rotation = limits;
+                    sessionName = name;
+                    format = traceFormat;
+                    trackNames.clear();
+                    if (!OpenFile(0)) throw std::runtime_error("cannot open trace file " + FilePath(0));
+                }
+                StartCollector();
             }
         
             void EndSession() {
+                if (!sessionActive.exchange(false)) return;
+                setProfileSink(TRACE_SINK, false);
+                collector.reset();
+                Flush();
                 std::lock_guard<std::mutex> lock(mutex_);
-                if (!sessionActive || !output) return;
-                *output << "{}]}";
+                if (!output) return;
+                WriteFooter();
+                CloseFile();
                 output = nullptr;
-                sessionActive = false;
+            }
+
+            // keeps the collector from writing while held, forking under it leaves the child no half written
+            // session output in its stream buffers to flush a second time
+            [[nodiscard]] std::unique_lock<std::mutex> HoldOutput() {
+                return std::unique_lock<std::mutex>(mutex_);
+            }
+
+            // forgets the session without writing to it, for forked children that share the stream,
+            // takes no lock since the child is forked while HoldOutput or another thread holds it
+            void AbandonSession() {
+                sessionActive.store(false, std::memory_order_relaxed);
+                setProfileSink(TRACE_SINK, false);
+                // the collector thread does not exist in the child, so there is nothing to join
+                static_cast<void>(collector.release());
+                // closing would flush the parent's buffered events into its file a second time
+                static_cast<void>(file.release());
+                static_cast<void>(fileBuffer.release());
+                output = nullptr;
+            }
+
+            // lock-free apart from the first event of every thread, which registers its ring
+            inline void Record(const TraceEvent& event) {
+                if (!TRACE_RING.ring) RegisterRing(TRACE_RING.ring, rings);
+                TRACE_RING.ring->push(event);
+            }
+
+            inline void Record(const TraceEvent& event, const CounterValues& counters) {
+                if (!TRACE_RING.counted) RegisterRing(TRACE_RING.counted, countedRings);
+                TRACE_RING.counted->push({ event, counters });
             }
         
             void WriteProfile(const ProfileResult& result) {
+                if (!isActive()) return;
+                const TraceEvent event{ TraceNames::Get().intern(result.name), result.threadID, result.start, result.end };
+                if (result.counted) {
+                    Record(event, result.counters);
+                } else {
+                    Record(event);
+                }
+            }
+
+            void NameTrack(uint32_t threadID, const std::string& name) {
                 std::lock_guard<std::mutex> lock(mutex_);
-                if (!sessionActive || !output){
+                if (!isActive() || !output){
                     return;
-                } 
-                *output << "{";
-                *output << "\"cat\":\"function\",";
-                *output << "\"dur\":" << (result.end - result.start) << ',';
-                *output << "\"name\":\"" << result.name << "\",";
-                *output << "\"ph\":\"X\",";
-                *output << "\"pid\":0,";
-                *output << "\"tid\":" << result.threadID << ",";
-                *output << "\"ts\":" << result.start;
-                *output << "},";
+                }
+                // kept so every rotated file names its tracks again
+                trackNames.emplace_back(threadID, name);
+                WriteTrackName(threadID, name);
+            }
+
+            // drains every ring into the session output, the collector calls it periodically
+            void Flush() {
+                std::lock_guard<std::mutex> lock(mutex_);
+                DrainAll(output);
+                // age limits run out without events too
+                if (file && RotationDue()) Rotate();
             }
+
         inline bool isActive(){
-            return sessionActive;
+            return sessionActive.load(std::memory_order_relaxed);
         }
         private:
-            std::ostream* output = nullptr;
+            void StartCollector() {
+                sessionActive.store(true, std::memory_order_release);
+                setProfileSink(TRACE_SINK, true);
+                collector = std::make_unique<std::jthread>([this](std::stop_token stop) {
+                    std::mutex waitMutex;
+                    std::condition_variable_any wake;
+                    std::unique_lock<std::mutex> lock(waitMutex);
+                    while (!stop.stop_requested()) {
+                        wake.wait_for(lock, stop, TRACE_FLUSH_INTERVAL, [] { return false; });
+                        Flush();
+                    }
+                });
+            }
+
+            // starts a file on its own, names, deltas and the dropped count restart with it,
+            // JSON files carry the session name in otherData, the binary header has no room for it
+            void WriteHeader() {
+                droppedEvents = 0;
+                namesWritten.clear();
+                lastStart = 0;
+                if (format == TraceFormat::BINARY) {
+                    output->write(BINARY_TRACE_MAGIC, sizeof(BINARY_TRACE_MAGIC));
+                    for (uint32_t field : { BINARY_TRACE_VERSION, 0u }) {
+                        for (int shift = 0; shift < 32; shift += 8) output->put(static_cast<char>(field >> shift));
+                    }
+                } else {
+                    *output << "{\"otherData\": {\"name\":\"";
+                    writeJsonEscaped(*output, sessionName);
+                    *output << "\"},\"traceEvents\":[";
+                }
+                for (const auto& [threadID, name] : trackNames) WriteTrackName(threadID, name);
+            }
+
+            void WriteFooter() {
+                if (format == TraceFormat::BINARY) {
+                    if (droppedEvents) {
+                        buffer.push_back(static_cast<char>(TraceRecord::DROPPED));
+                        putVarint(droppedEvents);
+                    }
+                    buffer.push_back(static_cast<char>(TraceRecord::END));
+                    output->write(buffer.data(), buffer.size());
+                    buffer.clear();
+                } else {
+                    if (droppedEvents) {
+                        *output << "{\"name\":\"dropped_events\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"count\":" << droppedEvents << "}},";
+                    }
+                    *output << "{}]}";
+                }
+                output->flush();
+            }
+
+            void WriteTrackName(uint32_t threadID, const std::string& name) {
+                if (format == TraceFormat::BINARY) {
+                    buffer.push_back(static_cast<char>(TraceRecord::TRACK_NAME));
+                    putVarint(threadID);
+                    putString(name);
+                    output->write(buffer.data(), buffer.size());
+                    buffer.clear();
+                    return;
+                }
+                *output << "{";
+                *output << "\"name\":\"thread_name\",";
+                *output << "\"ph\":\"M\",";
+                *output << "\"pid\":0,";
+                *output << "\"tid\":" << threadID << ",";
+                *output << "\"args\":{\"name\":\"";
+                writeJsonEscaped(*output, name);
+                *output << "\"}";
+                *output << "},";
+            }
+
+            bool Rotates() const {
+                return rotation.maxBytes || rotation.maxAge.count();
+            }
+
+            // trace.json stays trace.json without limits, with them files go trace.0.json, trace.1.json, ...
+            std::string FilePath(size_t index) const {
+                if (!Rotates()) return basePath;
+                const std::filesystem::path path(basePath);
+                return (path.parent_path() / (path.stem().string() + "." + std::to_string(index) + path.extension().string())).string();
+            }
+
+            bool RotationDue() {
+                if (rotation.maxBytes && static_cast<uint64_t>(output->tellp()) + buffer.size() >= rotation.maxBytes) return true;
+                return rotation.maxAge.count() && traceNow() - fileOpened >= std::chrono::duration_cast<std::chrono::nanoseconds>(rotation.maxAge).count();
+            }
+
+            // checked every ROTATION_CHECK events of a batch, a full ring would overshoot a size limit by megabytes
+            void RotateIfDue(size_t& sinceCheck) {
+                static constexpr size_t ROTATION_CHECK = 256;
+                if (!file || ++sinceCheck < ROTATION_CHECK) return;
+                sinceCheck = 0;
+                if (RotationDue()) Rotate();
+            }
+
+            // a file that cannot be opened keeps the session in the current one
+            void Rotate() {
+                static_cast<void>(OpenFile(fileIndex + 1));
+            }
+
+            // the current file is only finished once the next one is open
+            bool OpenFile(size_t index) {
+                auto nextBuffer = std::make_unique<char[]>(TRACE_WRITE_BUFFER);
+                auto next = std::make_unique<std::ofstream>();
+                // has to happen before open to take effect
+                next->rdbuf()->pubsetbuf(nextBuffer.get(), static_cast<std::streamsize>(TRACE_WRITE_BUFFER));
+                next->open(FilePath(index), std::ios::binary | std::ios::trunc);
+                if (!next->is_open()) return false;
+                if (file) {
+                    WriteFooter();
+                    CloseFile();
+                }
+                file = std::move(next);
+                fileBuffer = std::move(nextBuffer);
+                output = file.get();
+                fileIndex = index;
+                fileOpened = traceNow();
+                WriteHeader();
+                if (rotation.maxFiles && index >= rotation.maxFiles) {
+                    std::error_code ignored;
+                    std::filesystem::remove(FilePath(index - rotation.maxFiles), ignored);
+                }
+                return true;
+            }
+
+            void CloseFile() {
+                if (!file) return;
+                file->close();
+                file.reset();
+                fileBuffer.reset();
+            }
+
+            template<typename Ring>
+            void RegisterRing(std::shared_ptr<Ring>& ring, std::vector<std::shared_ptr<Ring>>& registry) {
+                ring = std::make_shared<Ring>();
+                std::lock_guard<std::mutex> lock(ringsMutex);
+                registry.push_back(ring);
+            }
+
+            void DrainAll(std::ostream* out) {
+                size_t sinceCheck = 0;
+                DrainRings(rings, out, sinceCheck);
+                DrainRings(countedRings, out, sinceCheck);
+            }
+
+            template<typename Ring>
+            void DrainRings(std::vector<std::shared_ptr<Ring>>& registry, std::ostream* out, size_t& sinceCheck) {
+                std::vector<std::shared_ptr<Ring>> snapshot;
+                {
+                    std::lock_guard<std::mutex> lock(ringsMutex);
+                    snapshot = registry;
+                }
+                std::vector<Ring*> finished;
+                for (auto& ring : snapshot) {
+                    // read before draining, a ring retired by then gets no more events
+                    const bool retired = ring->retired.load(std::memory_order_acquire);
+                    if (out && format == TraceFormat::BINARY) {
+                        ring->drain([&](const auto& event) {
+                            WriteBinaryEvent(event);
+                            RotateIfDue(sinceCheck);
+                        });
+                        output->write(buffer.data(), buffer.size());
+                        buffer.clear();
+                    } else if (out) {
+                        // output, not out, rotation may have moved it on
+                        ring->drain([&](const auto& event) {
+                            WriteEvent(*output, event);
+                            RotateIfDue(sinceCheck);
+                        });
+                    } else {
+                        ring->drain([](const auto&) {});
+                    }
+                    droppedEvents += ring->dropped.exchange(0, std::memory_order_relaxed);
+                    if (retired) finished.push_back(ring.get());
+                }
+                if (finished.empty()) return;
+                std::lock_guard<std::mutex> lock(ringsMutex);
+                std::erase_if(registry, [&](const std::shared_ptr<Ring>& ring) {
+                    return std::find(finished.begin(), finished.end(), ring.get()) != finished.end();
+                });
+            }
+
+            // Chrome wants microseconds, fractions keep the nanoseconds
+            static void WriteMicroseconds(std::ostream& out, long long ns) {
+                if (ns < 0) {
+                    out << '-';
+                    ns = -ns;
+                }
+                const long long fraction = ns % 1000;
+                out << ns / 1000 << '.' << static_cast<char>('0' + fraction / 100) << static_cast<char>('0' + fraction / 10 % 10) << static_cast<char>('0' + fraction % 10);
+            }
+
+            void WriteEvent(std::ostream& out, const CountedTraceEvent& counted) {
+                WriteEvent(out, counted.event, &counted.counters);
+            }
+
+            void WriteEvent(std::ostream& out, const TraceEvent& event, const CounterValues* counters = nullptr) {
+                if (event.nameID >= names.size()) TraceNames::Get().copy(static_cast<uint32_t>(names.size()), names);
+                out << "{";
+                if (counters) {
+                    out << "\"args\":{";
+                    out << "\"cycles\":" << counters->cycles << ",";
+                    out << "\"instructions\":" << counters->instructions << ",";
+                    out << "\"cache_misses\":" << counters->cacheMisses << ",";
+                    out << "\"branch_misses\":" << counters->branchMisses;
+                    out << "},";
+                }
+                out << "\"cat\":\"function\",";
+                out << "\"dur\":";
+                WriteMicroseconds(out, event.end - event.start);
+                out << ',';
+                out << "\"name\":\"";
+                writeJsonEscaped(out, names[event.nameID]);
+                out << "\",";
+                out << "\"ph\":\"X\",";
+                out << "\"pid\":0,";
+                out << "\"tid\":" << event.threadID << ",";
+                out << "\"ts\":";
+                WriteMicroseconds(out, event.start);
+                out << "},";
+            }
+
+            void putVarint(uint64_t value) {
+                while (value >= 0x80) {
+                    buffer.push_back(static_cast<char>(value | 0x80));
+                    value >>= 7;
+                }
+                buffer.push_back(static_cast<char>(value));
+            }
+
+            void putString(const std::string& text) {
+                putVarint(text.size());
+                buffer.append(text);
+            }
+
+            void WriteBinaryEvent(const CountedTraceEvent& counted) {
+                WriteBinaryEvent(counted.event, &counted.counters);
+            }
+
+            void WriteBinaryEvent(const TraceEvent& event, const CounterValues* counters = nullptr) {
+                if (event.nameID >= namesWritten.size()) namesWritten.resize(event.nameID + 1, false);
+                if (!namesWritten[event.nameID]) {
+                    if (event.nameID >= names.size()) TraceNames::Get().copy(static_cast<uint32_t>(names.size()), names);
+                    buffer.push_back(static_cast<char>(TraceRecord::NAME));
+                    putVarint(event.nameID);
+                    putString(names[event.nameID]);
+                    namesWritten[event.nameID] = true;
+                }
+                const long long delta = event.start - lastStart;
+                lastStart = event.start;
+                buffer.push_back(static_cast<char>(counters ? TraceRecord::COUNTED_EVENT : TraceRecord::EVENT));
+                putVarint(event.nameID);
+                putVarint(event.threadID);
+                putVarint((static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+                putVarint(static_cast<uint64_t>(event.end - event.start));
+                if (counters) {
+                    putVarint(counters->cycles);
+                    putVarint(counters->instructions);
+                    putVarint(counters->cacheMisses);
+                    putVarint(counters->branchMisses);
+                }
+            }
+
+            // guards output, the session file, names, the binary writer state and droppedEvents
             std::mutex mutex_;
-            bool sessionActive = false;
+            std::ostream* output = nullptr;
+            std::unique_ptr<std::ofstream> file;
+            std::unique_ptr<char[]> fileBuffer;
+            std::string basePath;
+            std::string sessionName;
+            TraceRotation rotation;
+            size_t fileIndex = 0;
+            long long fileOpened = 0;
+            std::vector<std::pair<uint32_t, std::string>> trackNames;
+            TraceFormat format = TraceFormat::JSON;
+            std::vector<std::string> names;
+            std::vector<bool> namesWritten;
+            long long lastStart = 0;
+            std::string buffer;
+            uint64_t droppedEvents = 0;
+            std::atomic<bool> sessionActive{ false };
+            std::mutex ringsMutex;
+            std::vector<std::shared_ptr<TraceRing>> rings;
+            std::vector<std::shared_ptr<CountedTraceRing>> countedRings;
+            // declared last so it is joined before anything it drains is destroyed
+            std::unique_ptr<std::jthread> collector;
         };
     
+    // log-bucketed latency histogram, 16 sub-buckets per power of two keep every bucket within 1/16 of
+    // its value, values below 16 ns are exact
+    class ScopeHistogram {
+        public:
+            static constexpr size_t SUB_BUCKETS = 16;
+            static constexpr size_t BUCKETS = (64 - 3) * SUB_BUCKETS;
+
+            static size_t bucketOf(uint64_t ns) {
+                if (ns < SUB_BUCKETS) return static_cast<size_t>(ns);
+                const int exponent = std::bit_width(ns) - 1;
+                return (exponent - 3) * SUB_BUCKETS + ((ns >> (exponent - 4)) & (SUB_BUCKETS - 1));
+            }
+            static uint64_t bucketLow(size_t bucket) {
+                if (bucket < SUB_BUCKETS) return bucket;
+                const int exponent = static_cast<int>(bucket / SUB_BUCKETS) + 3;
+                return (SUB_BUCKETS + bucket % SUB_BUCKETS) << (exponent - 4);
+            }
+            static uint64_t bucketHigh(size_t bucket) {
+                if (bucket < SUB_BUCKETS) return bucket;
+                const int exponent = static_cast<int>(bucket / SUB_BUCKETS) + 3;
+                return bucketLow(bucket) + (uint64_t(1) << (exponent - 4)) - 1;
+            }
+
+            // owner thread only, the counters are atomic so a concurrent report reads them without a race
+            void add(uint64_t ns) {
+                bump(count, 1);
+                bump(total, ns);
+                if (ns < min.load(std::memory_order_relaxed)) min.store(ns, std::memory_order_relaxed);
+                if (ns > max.load(std::memory_order_relaxed)) max.store(ns, std::memory_order_relaxed);
+                bump(buckets[bucketOf(ns)], 1);
+            }
+
+            void mergeInto(ScopeHistogram& target) const {
+                target.count.fetch_add(count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                target.total.fetch_add(total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                target.min.store(std::min(target.min.load(std::memory_order_relaxed), min.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+                target.max.store(std::max(target.max.load(std::memory_order_relaxed), max.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+                for (size_t i = 0; i < BUCKETS; ++i) {
+                    const uint64_t value = buckets[i].load(std::memory_order_relaxed);
+                    if (value) target.buckets[i].fetch_add(value, std::memory_order_relaxed);
+                }
+            }
+
+            void reset() {
+                count.store(0, std::memory_order_relaxed);
+                total.store(0, std::memory_order_relaxed);
+                min.store(UINT64_MAX, std::memory_order_relaxed);
+                max.store(0, std::memory_order_relaxed);
+                for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+            }
+
+            // value at quantile q, reported as the middle of its bucket and clamped to the observed range
+            uint64_t percentile(double q) const {
+                const uint64_t n = count.load(std::memory_order_relaxed);
+                if (n == 0) return 0;
+                const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * n)));
+                uint64_t seen = 0;
+                for (size_t i = 0; i < BUCKETS; ++i) {
+                    seen += buckets[i].load(std::memory_order_relaxed);
+                    if (seen >= rank) {
+                        const uint64_t middle = bucketLow(i) + (bucketHigh(i) - bucketLow(i)) / 2;
+                        return std::clamp(middle, min.load(std::memory_order_relaxed), max.load(std::memory_order_relaxed));
+                    }
+                }
+                return max.load(std::memory_order_relaxed);
+            }
+
+            std::atomic<uint64_t> count{ 0 };
+            std::atomic<uint64_t> total{ 0 };
+            std::atomic<uint64_t> min{ UINT64_MAX };
+            std::atomic<uint64_t> max{ 0 };
+            std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+
+        private:
+            // single writer, a plain load and store is enough and avoids a locked add
+            static void bump(std::atomic<uint64_t>& counter, uint64_t by) {
+                counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+            }
+    };
+
+    struct ScopeStatistics {
+        std::string name;
+        uint64_t count, total, min, max;
+        double mean;
+        uint64_t p50, p99, p999;
+    };
+
+    // per thread, per scope name statistics instead of events, memory grows with the number of
+    // distinct scopes and threads alive, never with run length
+    class Aggregator {
+        public:
+            static Aggregator& Get() {
+                static Aggregator instance;
+                return instance;
+            }
+
+            void Enable() {
+                enabled.store(true, std::memory_order_release);
+                setProfileSink(AGGREGATE_SINK, true);
+            }
+            void Disable() {
+                enabled.store(false, std::memory_order_release);
+                setProfileSink(AGGREGATE_SINK, false);
+            }
+            inline bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+            inline void Add(uint32_t nameID, uint64_t ns) {
+                ThreadTable* table = localTable();
+                // only this thread resizes its table, so it can read it without the lock
+                if (nameID < table->sites.size() && table->sites[nameID]) {
+                    table->sites[nameID]->add(ns);
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(table->mutex);
+                if (nameID >= table->sites.size()) table->sites.resize(nameID + 1);
+                table->sites[nameID] = std::make_unique<ScopeHistogram>();
+                table->sites[nameID]->add(ns);
+            }
+
+            // merges every thread, the threads that already exited included
+            std::vector<ScopeStatistics> Report() {
+                std::vector<std::unique_ptr<ScopeHistogram>> merged;
+                auto mergeTable = [&](const std::vector<std::unique_ptr<ScopeHistogram>>& sites) {
+                    if (merged.size() < sites.size()) merged.resize(sites.size());
+                    for (size_t id = 0; id < sites.size(); ++id) {
+                        if (!sites[id]) continue;
+                        if (!merged[id]) merged[id] = std::make_unique<ScopeHistogram>();
+                        sites[id]->mergeInto(*merged[id]);
+                    }
+                };
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    mergeTable(exited);
+                    for (ThreadTable* table : tables) {
+                        std::lock_guard<std::mutex> tableLock(table->mutex);
+                        mergeTable(table->sites);
+                    }
+                }
+
+                std::vector<std::string> names;
+                TraceNames::Get().copy(0, names);
+                std::vector<ScopeStatistics> report;
+                for (size_t id = 0; id < merged.size(); ++id) {
+                    if (!merged[id]) continue;
+                    const ScopeHistogram& histogram = *merged[id];
+                    const uint64_t count = histogram.count.load(std::memory_order_relaxed);
+                    if (count == 0) continue;
+                    const uint64_t total = histogram.total.load(std::memory_order_relaxed);
+                    report.push_back({ id < names.size() ? names[id] : std::to_string(id), count, total,
+                        histogram.min.load(std::memory_order_relaxed), histogram.max.load(std::memory_order_relaxed),
+                        static_cast<double>(total) / count,
+                        histogram.percentile(0.50), histogram.percentile(0.99), histogram.percentile(0.999) });
+                }
+                std::sort(report.begin(), report.end(), [](const ScopeStatistics& a, const ScopeStatistics& b) { return a.total > b.total; });
+                return report;
+            }
+
+            // one line per scope, the most expensive first
+            void WriteReport(std::ostream& out) {
+                for (const ScopeStatistics& scope : Report()) {
+                    out << "SCOPE:: " << scope.name;
+                    out << " count:: " << scope.count;
+                    out << " X total:: " << scope.total << "ns";
+                    out << " X mean:: " << static_cast<uint64_t>(scope.mean) << "ns";
+                    out << " X min:: " << scope.min << "ns";
+                    out << " X p50:: " << scope.p50 << "ns";
+                    out << " X p99:: " << scope.p99 << "ns";
+                    out << " X p999:: " << scope.p999 << "ns";
+                    out << " X max:: " << scope.max << "ns";
+                    out << "\n";
+                }
+            }
+
+            // meant for quiet moments, a scope closing while this runs may keep part of its sample
+            void Reset() {
+                std::lock_guard<std::mutex> lock(mutex_);
+                exited.clear();
+                for (ThreadTable* table : tables) {
+                    std::lock_guard<std::mutex> tableLock(table->mutex);
+                    for (auto& site : table->sites) {
+                        if (site) site->reset();
+                    }
+                }
+            }
+
+        private:
+            struct ThreadTable {
+                // taken by the owner only to grow sites, and by reports
+                std::mutex mutex;
+                std::vector<std::unique_ptr<ScopeHistogram>> sites;
+            };
+
+            // folds the table of an exiting thread into exited, so thread churn does not grow memory
+            struct TableHandle {
+                std::unique_ptr<ThreadTable> table;
+                ~TableHandle() {
+                    if (table) Aggregator::Get().Retire(table.get());
+                }
+            };
+
+            ThreadTable* localTable() {
+                thread_local TableHandle handle;
+                if (!handle.table) {
+                    handle.table = std::make_unique<ThreadTable>();
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    tables.push_back(handle.table.get());
+                }
+                return handle.table.get();
+            }
+
+            void Retire(ThreadTable* table) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                std::erase(tables, table);
+                if (exited.size() < table->sites.size()) exited.resize(table->sites.size());
+                for (size_t id = 0; id < table->sites.size(); ++id) {
+                    if (!table->sites[id]) continue;
+                    if (!exited[id]) exited[id] = std::make_unique<ScopeHistogram>();
+                    table->sites[id]->mergeInto(*exited[id]);
+                }
+            }
+
+            std::atomic<bool> enabled{ false };
+            // guards tables and exited
+            std::mutex mutex_;
+            std::vector<ThreadTable*> tables;
+            std::vector<std::unique_ptr<ScopeHistogram>> exited;
+    };
+    
     class ScopeTimer {
     public:
-        ScopeTimer(const std::string& name)
-            : name(name), start(std::chrono::high_resolution_clock::now()) {}
-    
+        ScopeTimer(const std::string& name, uint32_t category = ProfileCategory::DEFAULT) {
+            if (!(ACTIVE_PROFILE_CATEGORIES.load(std::memory_order_relaxed) & category)) return;
+            begin(TraceNames::Get().intern(name));
+        }
+
+        // the name is only produced once the category is known to be enabled
+        template<typename NameID>
+            requires std::is_invocable_r_v<uint32_t, NameID>
+        ScopeTimer(uint32_t category, NameID&& nameID) {
+            if (!(ACTIVE_PROFILE_CATEGORIES.load(std::memory_order_relaxed) & category)) return;
+            begin(nameID());
+        }
+
+        ScopeTimer(const ScopeTimer&) = delete;
+        ScopeTimer& operator=(const ScopeTimer&) = delete;
+
         ~ScopeTimer() {
-            auto endTime = std::chrono::high_resolution_clock::now();
-            long long startNs = std::chrono::time_point_cast<std::chrono::microseconds>(start).time_since_epoch().count();
-            long long endNs = std::chrono::time_point_cast<std::chrono::microseconds>(endTime).time_since_epoch().count();
-            uint32_t threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
-    
-            Instrumentor::Get().WriteProfile({ name, startNs, endNs, threadID });
+            if (active) finish();
         }
-    
+
     private:
-        std::string name;
-        std::chrono::time_point<std::chrono::high_resolution_clock> start;
+        void begin(uint32_t id) {
+            nameID = id;
+            active = true;
+            counted = readProfileCounters(counters);
+            start = traceNow();
+        }
+
+        void finish() {
+            const long long end = traceNow();
+            const TraceEvent event{ nameID, currentTrack(), start, end };
+            CounterValues now;
+            const bool hasCounters = counted && PerfCounters::Local().read(now);
+            Aggregator& aggregator = Aggregator::Get();
+            Instrumentor& instrumentor = Instrumentor::Get();
+            if (aggregator.isEnabled()) aggregator.Add(nameID, static_cast<uint64_t>(end - start));
+            if (!instrumentor.isActive()) return;
+            if (hasCounters) {
+                instrumentor.Record(event, now - counters);
+            } else {
+                instrumentor.Record(event);
+            }
+        }
+
+        uint32_t nameID = 0;
+        bool active = false;
+        bool counted = false;
+        long long start = 0;
+        CounterValues counters;
+    };
+
+    // string literals have this type, a mutable char buffer can hold another name on every pass
+    template<typename T>
+    inline constexpr bool isConstCharArray = std::is_array_v<T> && std::is_same_v<std::remove_extent_t<T>, const char>;
+
+    // scopes whose category is outside PROFILE_COMPILED_CATEGORIES, the name is never evaluated
+    template<bool Compiled>
+    class ProfileScope : public ScopeTimer {
+    public:
+        using ScopeTimer::ScopeTimer;
     };
+
+    template<>
+    class ProfileScope<false> {
+    public:
+        template<typename... Args>
+        explicit ProfileScope(Args&&...) {}
+    };
+
     class DefaultTimer{
         private:
         std::string name;
-        std::chrono::time_point<std::chrono::high_resolution_clock> _start;
+        long long _start = 0;
+        bool counted = false;
+        CounterValues counters;
         public:
         DefaultTimer(const std::string& name)
             : name(name){}
     
         void start(){
-            _start = std::chrono::high_resolution_clock::now();
+            counted = readProfileCounters(counters);
+            _start = traceNow();
         }
         void defaultStop(){
             write(stop());
         }
         ProfileResult stop(){
-            auto endTime = std::chrono::high_resolution_clock::now();
-            long long startNs = std::chrono::time_point_cast<std::chrono::microseconds>(_start).time_since_epoch().count();
-            long long endNs = std::chrono::time_point_cast<std::chrono::microseconds>(endTime).time_since_epoch().count();
-            uint32_t threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
-            return {name, startNs, endNs, threadID};
+            ProfileResult result{name, _start, traceNow(), currentTrack()};
+            CounterValues now;
+            if (counted && PerfCounters::Local().read(now)) {
+                result.counters = now - counters;
+                result.counted = true;
+            }
+            return result;
         }
         void write(ProfileResult result){
             Instrumentor::Get().WriteProfile(result);
@@ -2,12 +2,36 @@
 #define _TOKEN_UTILS_H
 #include "logic_utils.h"
 #include <string_utils.h>
+#include <symbol_utils.h>
 #include <string>
 #include <vector>
 #include <array>
+#include <type_traits>
+#include <string_view>
+#include <stdexcept>
+#include <functional>
+#include <span>
+#include <initializer_list>
+#include <utility>
+#include <memory>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <optional>
+#include <algorithm>
+#include <memory_resource>
+#include <chrono>
+#include <istream>
 #include <immintrin.h>
 #include <xmemory>
 
+#if defined(_MSC_VER)
+#define CAKILGAN_TARGET(isa)
+#else
+#define CAKILGAN_TARGET(isa) __attribute__((target(isa)))
+#endif
+
 namespace Utils::TokenUtils{
     enum class TokenType : uint8_t {
         ALPHABETIC,
@@ -20,51 +44,516 @@ namespace Utils::TokenUtils{
     };
     
     const char* getEnumName(TokenType tokenType);
+
+    enum class SIMDLevel : uint8_t {
+        SCALAR,
+        SSE42,
+        AVX2,
+        AVX512BW
+    };
+
+    const char* getEnumName(SIMDLevel level);
     
-    struct Token :Utils::LogicUtils::canStringfy{
+    // one Token per input byte, kept at 2 bytes and trivially copyable so kernels can store it directly
+    struct Token{
         TokenType tokenType;
         char literalValue;
         Token(): tokenType(TokenType::UNKNOWN), literalValue(' '){}
         Token(TokenType type,char literalValue): tokenType(type), literalValue(literalValue){}
-        std::string toString() const override{ 
+        std::string toString() const{ 
             return StringUtils::as_str(getEnumName(tokenType), "::", literalValue);
         }
     };
+    static_assert(sizeof(Token) == 2 && std::is_trivially_copyable_v<Token>);
+    static_assert(Utils::LogicUtils::Stringfiable<Token>);
+
+    // the 256 entry table split into 3 bit planes of the TokenType, planes[k][low nibble] has bit h set
+    // when row h (high nibble) has plane k set; bytes >= 0x80 hit no row and decode to fallback
+    struct SIMDClassTables{
+        alignas(16) std::array<uint8_t, 16> rowBits;
+        alignas(16) std::array<std::array<uint8_t, 16>, 3> planes;
+        uint8_t fallback;
+    };
+
+    // compile-time declaration of the character classes, every with* call regenerates both the scalar
+    // table and the SIMD tables so they can not disagree
+    //   constexpr auto dsl = CharClassifier::defaults().with(TokenType::ALPHABETIC, "_").withOperators("^<>");
+    class CharClassifier{
+        public:
+        constexpr CharClassifier(): table{}, operators{}, simd{}, utf8(false){
+            table.fill(TokenType::UNKNOWN);
+            rebuild();
+        }
+
+        static constexpr CharClassifier defaults(){
+            return CharClassifier()
+                .withRange(TokenType::NUMERIC, '0', '9')
+                .withRange(TokenType::ALPHABETIC, 'A', 'Z')
+                .withRange(TokenType::ALPHABETIC, 'a', 'z')
+                .with(TokenType::WHITESPACE, " \t\r\f\v")
+                .with(TokenType::NEWLINE, "\n")
+                .with(TokenType::PUNCTUATION, ".,;:!?-'\"()[]{}/\\@#$%^&*+=<>|~`_")
+                .withOperators("+-*/%");
+        }
+
+        constexpr CharClassifier with(TokenType type, std::string_view chars) const{
+            CharClassifier result = *this;
+            for (char c : chars) result.table[ascii(c)] = type;
+            result.rebuild();
+            return result;
+        }
+        constexpr CharClassifier withRange(TokenType type, char first, char last) const{
+            CharClassifier result = *this;
+            for (int c = ascii(first); c <= ascii(last); ++c) result.table[c] = type;
+            result.rebuild();
+            return result;
+        }
+        // SIMD kernels only see the high bit of non-ASCII bytes, so they share one class
+        constexpr CharClassifier withHighBytes(TokenType type) const{
+            CharClassifier result = *this;
+            for (int c = 0x80; c < 256; ++c) result.table[c] = type;
+            result.rebuild();
+            return result;
+        }
+        // single separator characters typed as WordTokenTypes::OPERATOR by the word segmentation,
+        // added to the current operators like with() adds to its class
+        constexpr CharClassifier withOperators(std::string_view chars) const{
+            CharClassifier result = *this;
+            for (char c : chars) result.operators[ascii(c)] = true;
+            return result;
+        }
+        constexpr CharClassifier withoutOperators(std::string_view chars) const{
+            CharClassifier result = *this;
+            for (char c : chars) result.operators[ascii(c)] = false;
+            return result;
+        }
+
+        // bytes >= 0x80 are decoded as UTF-8 and classified per codepoint, see Utf8::classifyCodepoint
+        constexpr CharClassifier withUtf8() const{
+            CharClassifier result = *this;
+            result.utf8 = true;
+            return result;
+        }
+
+        constexpr TokenType classify(char c) const{ return table[static_cast<unsigned char>(c)]; }
+        constexpr bool isOperator(char c) const{ return operators[static_cast<unsigned char>(c)]; }
+        constexpr bool isSeparator(char c) const{ return isSeparator(classify(c)); }
+        static constexpr bool isSeparator(TokenType type){
+            return type == TokenType::WHITESPACE || type == TokenType::PUNCTUATION;
+        }
+
+        std::array<TokenType, 256> table;
+        std::array<bool, 256> operators;
+        SIMDClassTables simd;
+        bool utf8;
+
+        private:
+        static constexpr int ascii(char c){
+            const int value = static_cast<unsigned char>(c);
+            if (value >= 0x80) throw std::invalid_argument("CharClassifier: use withHighBytes for bytes >= 0x80");
+            return value;
+        }
+        constexpr void rebuild(){
+            simd = SIMDClassTables{};
+            simd.fallback = static_cast<uint8_t>(table[0x80]);
+            for (int h = 0; h < 8; ++h) {
+                simd.rowBits[h] = static_cast<uint8_t>(1u << h);
+                for (int l = 0; l < 16; ++l) {
+                    const uint8_t code = static_cast<uint8_t>(table[h * 16 + l]) ^ simd.fallback;
+                    for (int k = 0; k < 3; ++k) {
+                        if ((code >> k) & 1) simd.planes[k][l] |= static_cast<uint8_t>(1u << h);
+                    }
+                }
+            }
+        }
+    };
+
+    inline constexpr CharClassifier DEFAULT_CHAR_CLASSES = CharClassifier::defaults();
+    inline constexpr CharClassifier UTF8_CHAR_CLASSES = CharClassifier::defaults().withUtf8();
+
+    namespace Utf8{
+        bool validate(std::string_view input);
+        // length of the leading run of ASCII bytes
+        size_t asciiPrefix(std::string_view input);
+        // byte length of the sequence at the front of input, 0 when it is invalid or truncated
+        size_t decode(std::string_view input, char32_t& codepoint);
+        // letters and marks are ALPHABETIC, Nd is NUMERIC, P and S are PUNCTUATION, Zs is WHITESPACE
+        TokenType classifyCodepoint(char32_t codepoint);
+        // class of the character starting at input[index], decoded per codepoint when classes.utf8 is set
+        TokenType classifyAt(std::string_view input, size_t index, const CharClassifier& classes);
+        // start of the last character of a non-empty input, a stray continuation byte counts as one
+        size_t lastCharacter(std::string_view input);
+        // bytes at the end of input that begin a sequence only more input can complete
+        size_t incompleteSuffix(std::string_view input);
+    }
     namespace Tokenizer {
-        std::vector<Token> SIMDTokenize(std::string_view input);
-        std::vector<Token> defaultTokenize(std::string_view input);
-        
+        std::vector<Token> SIMDTokenize(std::string_view input, const CharClassifier& classes = DEFAULT_CHAR_CLASSES);
+        // reuses out's capacity, out is resized to input.size()
+        void SIMDTokenize(std::string_view input, std::vector<Token>& out, const CharClassifier& classes = DEFAULT_CHAR_CLASSES);
+        // out must have room for input.size() tokens
+        void SIMDTokenize(std::string_view input, Token* out, const CharClassifier& classes = DEFAULT_CHAR_CLASSES);
+        std::vector<Token> defaultTokenize(std::string_view input, const CharClassifier& classes = DEFAULT_CHAR_CLASSES);
+        TokenType getTokenType(char c);
+
+        // kernel used by SIMDTokenize, detected through cpuid once on first use
+        SIMDLevel detectSIMDLevel();
+        SIMDLevel getSIMDLevel();
+        // clamps to the detected level, lower levels are useful for comparisons
+        void setSIMDLevel(SIMDLevel level);
     }
+    // ids come from a dedicated symbol table that interns the builtin names first, in this order
     struct WordTokenType{
         const char* tokenTypeName;
+        Utils::SymbolUtils::Symbol id;
+        constexpr WordTokenType(): tokenTypeName("UNKNOWN"), id(0){}
+        constexpr WordTokenType(const char* tokenTypeName, Utils::SymbolUtils::Symbol id): tokenTypeName(tokenTypeName), id(id){}
+        WordTokenType(const char* tokenTypeName);
         bool operator==(const WordTokenType& other) const{
-            return tokenTypeName == other.tokenTypeName;
+            return id == other.id;
+        }
+    };
+    namespace WordTokenTypes{
+        inline constexpr WordTokenType UNKNOWN{"UNKNOWN", 0};
+        inline constexpr WordTokenType ALL_NUMBER{"ALL_NUMBER", 1};
+        inline constexpr WordTokenType ALL_ALPHA{"ALL_ALPHA", 2};
+        inline constexpr WordTokenType OPERATOR{"OPERATOR", 3};
+    }
+    // a word as a view into the segmented input, no characters are copied
+    struct WordSpan{
+        size_t offset;
+        uint32_t length;
+        WordTokenType type;
+        std::string_view view(std::string_view source) const{
+            return source.substr(offset, length);
         }
     };
+    // characterTokens is the only state, the text is derived from it and symbols are only
+    // handed out by a table the caller owns, so tokenizing never grows a process-wide table
     struct WordToken : Utils::LogicUtils::canStringfy{
       std::vector<Token> characterTokens;
       WordTokenType type;
-      WordToken():characterTokens({}), type({"UNKNOWN"}){}
-      WordToken(const std::vector<Token>& characterTokens): characterTokens(characterTokens){}
+      WordToken():characterTokens({}), type(WordTokenTypes::UNKNOWN){}
+      WordToken(const std::vector<Token>& characterTokens): characterTokens(characterTokens), type(WordTokenTypes::UNKNOWN){}
       WordToken(const std::vector<Token>& characterTokens, const WordTokenType& type): characterTokens(characterTokens), type(type){}
-      WordToken(const char* fromLiteral): characterTokens(Utils::TokenUtils::Tokenizer::defaultTokenize(fromLiteral)){}
-      WordToken(const std::string& fromLiteral): characterTokens(Utils::TokenUtils::Tokenizer::defaultTokenize(fromLiteral)){}
-      std::string toString() const override{
-        std::string result;
-        for(const auto& token : characterTokens){
-          result+=token.literalValue;
-        }
+      WordToken(const char* fromLiteral): characterTokens(Utils::TokenUtils::Tokenizer::defaultTokenize(fromLiteral)), type(WordTokenTypes::UNKNOWN){}
+      WordToken(const std::string& fromLiteral): characterTokens(Utils::TokenUtils::Tokenizer::defaultTokenize(fromLiteral)), type(WordTokenTypes::UNKNOWN){}
+      std::string text() const{
+        std::string result(characterTokens.size(), '\0');
+        for (size_t i = 0; i < characterTokens.size(); ++i) result[i] = characterTokens[i].literalValue;
         return result;
       }
+      // a single character word holding c
+      bool is(char c) const{
+        return characterTokens.size() == 1 && characterTokens[0].literalValue == c;
+      }
+      // equal words share one symbol within a table
+      Utils::SymbolUtils::Symbol intern(Utils::SymbolUtils::SymbolTable& table) const{
+        return table.intern(text());
+      }
+      std::string toString() const override{
+        return text();
+      }
+      // compares characters rather than symbols since words are deliberately not interned, see above
+      bool operator==(const WordToken& other) const{
+        return std::equal(characterTokens.begin(), characterTokens.end(), other.characterTokens.begin(), other.characterTokens.end(),
+                          [](const Token& a, const Token& b) { return a.literalValue == b.literalValue; });
+      }
     };
    namespace Tokenizer{
-    std::vector<WordToken> spaceAndPunctuationWordTokenize(std::vector<Token> input);
+    // classes only decides which separators are operators, the tokens carry their classes already
+    std::vector<WordToken> spaceAndPunctuationWordTokenize(const std::vector<Token>& input, const CharClassifier& classes = DEFAULT_CHAR_CLASSES);
+
+    // same segmentation as spaceAndPunctuationWordTokenize straight from the raw input, spans are appended to out
+    void segmentWords(std::string_view input, std::vector<WordSpan>& out, const CharClassifier& classes = DEFAULT_CHAR_CLASSES);
+    std::vector<WordSpan> segmentWords(std::string_view input, const CharClassifier& classes = DEFAULT_CHAR_CLASSES);
 
     float basicParseAndEvaulateMathExpression(std::vector<WordToken> tokenizedText);
+
+    // leaves hold a number or a variable name, unary minus only has a left child,
+    // function calls keep their arguments in order
+    struct Node {
+        enum class Kind : uint8_t{ OPERATOR, CALL, NUMBER, VARIABLE };
+        Kind kind = Kind::OPERATOR;
+        std::pmr::string value;
+        Node* left = nullptr;
+        Node* right = nullptr;
+        std::pmr::vector<Node*> arguments;
+        Node(std::string_view v, std::pmr::memory_resource* resource): value(v, resource), arguments(resource) {}
+    };
+
+    // monotonic memory for parse trees and compiler scratch, nodes are never destroyed one by one,
+    // reset drops everything at once and keeps a single buffer as large as the busiest parse so far
+    class ParseArena{
+        public:
+        explicit ParseArena(size_t initialBytes = 4096);
+        ParseArena(const ParseArena&) = delete;
+        ParseArena& operator=(const ParseArena&) = delete;
+
+        inline std::pmr::memory_resource* resource() { return &counter; }
+        Node* makeNode(std::string_view value);
+        void reset();
+
+        // counted since the last reset
+        inline size_t bytesUsed() const { return counter.bytes; }
+        inline size_t nodesUsed() const { return nodes; }
+        inline size_t peakBytes() const { return std::max(peak, counter.bytes); }
+        inline size_t capacity() const { return initialSize; }
+
+        private:
+        struct CountingResource : std::pmr::memory_resource {
+            std::pmr::memory_resource* upstream = nullptr;
+            size_t bytes = 0;
+            void* do_allocate(size_t size, size_t alignment) override;
+            void do_deallocate(void*, size_t, size_t) override {}
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+        };
+
+        std::unique_ptr<std::byte[]> initial;
+        size_t initialSize;
+        std::optional<std::pmr::monotonic_buffer_resource> monotonic;
+        CountingResource counter;
+        size_t nodes = 0;
+        size_t peak = 0;
+    };
+
+    // nesting of parentheses, calls, unary minus and ^ chains the recursive parser accepts before it throws
+    inline constexpr size_t MAX_EXPRESSION_DEPTH = 256;
+
+    // single pass precedence climbing: + - < * / % < unary - < ^ (right associative),
+    // whitespace words are skipped, throws std::invalid_argument on malformed input.
+    // numbers are read like strtod reads them (1.5e-3, .5, 0x1p4) even across several words,
+    // names start with a letter and may contain digits. the tree lives in arena
+    Node* parse(std::string_view source, std::span<const WordSpan> words, ParseArena& arena);
+    Node* parse(const std::vector<Utils::TokenUtils::WordToken>& words, ParseArena& arena);
+
+    enum class OpCode : uint8_t{
+        CONSTANT,
+        VARIABLE,
+        LOAD,
+        STORE,
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE,
+        MODULO,
+        POWER,
+        NEGATE,
+        MIN,
+        MAX,
+        SIN,
+        COS,
+        TAN,
+        LOG,
+        SQRT,
+        ABS
+    };
+    const char* getEnumName(OpCode op);
+
+    // operand indexes constants for CONSTANT, variables for VARIABLE and registers for LOAD / STORE,
+    // STORE copies the top of the stack into a register without popping it
+    struct Instruction{
+        OpCode op;
+        uint32_t operand;
+    };
+
+    // postfix program compiled once from the grammar of basicParseAndEvaulateMathExpression,
+    // alphabetic words that are not function names become variables bound at evaluation time
+    class CompiledExpression{
+        public:
+        static constexpr size_t NO_VARIABLE = static_cast<size_t>(-1);
+
+        CompiledExpression() = default;
+        // optimize folds constants, applies identities that are exact in float arithmetic
+        // and computes repeated subexpressions once through registers
+        static CompiledExpression compile(std::string_view source, bool optimize = true);
+        static CompiledExpression compile(const std::vector<WordToken>& words, bool optimize = true);
+        // arena is reset before parsing, the overloads above use one arena per thread
+        static CompiledExpression compile(const std::vector<WordToken>& words, ParseArena& arena, bool optimize = true);
+        // words from segmentWords over source, skips building WordTokens
+        static CompiledExpression compile(std::string_view source, std::span<const WordSpan> words, ParseArena& arena, bool optimize = true);
+
+        // values are indexed like variables(), evaluation does not allocate,
+        // % throws std::invalid_argument for a zero divisor or operands outside int, unlike evaluateBatch
+        float evaluate(std::span<const float> values = {}) const;
+        float evaluate(std::initializer_list<std::pair<std::string_view, float>> bindings) const;
+
+        // columns are indexed like variables() and hold at least output.size() rows, the program runs
+        // one instruction at a time over blocks of rows so each operator is a vector loop,
+        // % yields NaN in the affected rows instead of throwing so one bad row does not abort the batch
+        void evaluateBatch(std::span<const std::span<const float>> columns, std::span<float> output) const;
+        void evaluateBatch(std::span<const std::span<const double>> columns, std::span<double> output) const;
+
+        size_t variableIndex(std::string_view name) const;
+        inline const std::vector<std::string>& variables() const { return variableNames; }
+        inline const std::vector<Instruction>& code() const { return program; }
+        inline const std::vector<float>& constants() const { return constantPool; }
+        // same indexes as constants(), parsed and folded in double precision for the double evaluateBatch
+        inline const std::vector<double>& doubleConstants() const { return doubleConstantPool; }
+        inline size_t stackDepth() const { return maxDepth; }
+        inline size_t registers() const { return registerCount; }
+        std::string toString() const;
+
+        private:
+        friend class ExpressionBuilder;
+        template<typename T>
+        void runBatch(std::span<const std::span<const T>> columns, std::span<T> output) const;
+        void emit(OpCode op, uint32_t operand = 0);
+
+        std::vector<Instruction> program;
+        std::vector<float> constantPool;
+        std::vector<double> doubleConstantPool;
+        std::vector<std::string> variableNames;
+        size_t maxDepth = 0;
+        size_t depth = 0;
+        size_t registerCount = 0;
+    };
+
+    // bounded least recently used map from source text to compiled programs, safe to share between threads
+    class ExpressionCache{
+        public:
+        explicit ExpressionCache(size_t capacity = 1024);
+
+        // compiles on a miss, compile errors are thrown and not cached
+        std::shared_ptr<const CompiledExpression> get(std::string_view source);
+        void clear();
+        size_t size() const;
+        inline size_t capacity() const { return limit; }
+        inline size_t hits() const { return hitCount.load(std::memory_order_relaxed); }
+        inline size_t misses() const { return missCount.load(std::memory_order_relaxed); }
+
+        static ExpressionCache& global();
+
+        private:
+        using Entry = std::pair<std::string, std::shared_ptr<const CompiledExpression>>;
+
+        mutable std::mutex mutex;
+        // most recent first, index keys view the strings held by the list nodes
+        std::list<Entry> order;
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+        size_t limit;
+        std::atomic<size_t> hitCount{0};
+        std::atomic<size_t> missCount{0};
+    };
+
+    // goes through ExpressionCache::global(), so repeated formulas skip tokenizing and parsing
+    float basicParseAndEvaulateMathExpression(std::string_view text);
+
+    // per formula results of bulkEvaluate, a failing formula gets NaN and its error message
+    struct BulkEvaluation{
+        std::vector<float> values;
+        std::vector<std::string> errors;
+        size_t failures = 0;
+        std::chrono::nanoseconds elapsed{0};
+
+        inline bool succeeded(size_t index) const { return errors[index].empty(); }
+        // formulas per second over the whole call
+        inline double throughput() const {
+            return elapsed.count() ? values.size() * 1e9 / static_cast<double>(elapsed.count()) : 0.0;
+        }
+    };
+
+    // segments, parses and evaluates every formula on a work stealing set of threads, each with its own
+    // ParseArena and span buffer, threadCount 0 uses std::thread::hardware_concurrency
+    BulkEvaluation bulkEvaluate(std::span<const std::string_view> formulas, size_t threadCount = 0);
+    BulkEvaluation bulkEvaluate(std::span<const std::string> formulas, size_t threadCount = 0);
+
+    // incremental segmentation with memory bounded by the chunk size and the longest word,
+    // offsets in the emitted spans are absolute positions in the stream
+    class StreamTokenizer{
+        public:
+        using WordConsumer = std::function<void(const WordSpan& span, std::string_view word)>;
+        using TokenConsumer = std::function<void(std::span<const Token> tokens, size_t offset)>;
+
+        explicit StreamTokenizer(WordConsumer onWord, TokenConsumer onTokens = nullptr, const CharClassifier& classes = DEFAULT_CHAR_CLASSES);
+
+        // views passed to the consumers are only valid during the callback
+        void feed(std::string_view chunk);
+        void finish();
+        inline size_t consumed() const { return position; }
+
+        private:
+        void process(std::string_view chunk);
+        void emitCarry();
+
+        WordConsumer onWord;
+        TokenConsumer onTokens;
+        CharClassifier classes;
+        // start of a UTF-8 sequence cut by the chunk boundary, waiting for its remaining bytes
+        std::string pending;
+        std::string carry;
+        WordTokenType carryType = WordTokenTypes::UNKNOWN;
+        size_t carryOffset = 0;
+        size_t position = 0;
+        std::vector<Token> tokens;
+        std::vector<WordSpan> spans;
+    };
+
+    void tokenizeStream(std::istream& input, const StreamTokenizer::WordConsumer& onWord,
+                        const StreamTokenizer::TokenConsumer& onTokens = nullptr, size_t chunkSize = 1 << 16,
+                        const CharClassifier& classes = DEFAULT_CHAR_CLASSES);
+
+    // read-only memory mapping of a whole file, throws std::runtime_error when the file can not be mapped
+    class MappedFile{
+        public:
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        inline std::string_view view() const { return {data, size}; }
+
+        private:
+        void unmap();
+
+        const char* data = nullptr;
+        size_t size = 0;
+    };
+
+    struct FileSegment{
+        size_t offset;
+        size_t length;
+        std::vector<Token> tokens;
+        std::vector<WordSpan> words;
+    };
+
+    // words always carry absolute file offsets, segments are only filled when merge is off
+    struct FileTokenization{
+        MappedFile file;
+        std::vector<Token> tokens;
+        std::vector<WordSpan> words;
+        std::vector<FileSegment> segments;
+    };
+
+    // splits the mapped file on separator bytes so every segment segments exactly like the whole file would,
+    // threadCount 0 uses std::thread::hardware_concurrency
+    FileTokenization parallelTokenizeFile(const std::string& path, size_t threadCount = 0, bool merge = true,
+                                          const CharClassifier& classes = DEFAULT_CHAR_CLASSES);
    }
 }
 
 
 
 
+template<>
+struct std::hash<Utils::TokenUtils::WordTokenType>{
+    size_t operator()(const Utils::TokenUtils::WordTokenType& type) const noexcept{
+        return std::hash<Utils::SymbolUtils::Symbol>{}(type.id);
+    }
+};
+
+template<>
+struct std::hash<Utils::TokenUtils::WordToken>{
+    // the same FNV-1a as hashText(word.text()), run over the tokens in place so hashing never allocates
+    size_t operator()(const Utils::TokenUtils::WordToken& word) const noexcept{
+        uint64_t hash = 14695981039346656037ull;
+        for (const Utils::TokenUtils::Token& token : word.characterTokens) {
+            hash ^= static_cast<unsigned char>(token.literalValue);
+            hash *= 1099511628211ull;
+        }
+        return hash ^ (hash >> 32);
+    }
+};
+
 #endif /* _TOKEN_UTILS_H */
@@ -0,0 +1,115 @@
+#include <symbol_utils.h>
+#include <cstring>
+#include <mutex>
+#include <algorithm>
+
+namespace Utils::SymbolUtils
+{
+    constexpr size_t ARENA_BLOCK_SIZE = 64 * 1024;
+    constexpr size_t INITIAL_SLOTS = 64;
+
+    uint64_t hashText(std::string_view text){
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : text) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash ^ (hash >> 32);
+    }
+
+    SymbolTable::SymbolTable(bool concurrent)
+        : concurrent(concurrent), slots(INITIAL_SLOTS, INVALID_SYMBOL) {}
+
+    Symbol SymbolTable::findLocked(std::string_view text, uint64_t hash) const{
+        const size_t mask = slots.size() - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            const Symbol symbol = slots[slot];
+            if (symbol == INVALID_SYMBOL) return INVALID_SYMBOL;
+            const Entry& entry = entries[symbol];
+            if (entry.hash == hash && entry.text == text) return symbol;
+        }
+    }
+
+    const char* SymbolTable::store(std::string_view text){
+        const size_t required = text.size() + 1;
+        if (blocks.empty() || blockUsed + required > blockSize) {
+            blockSize = std::max(ARENA_BLOCK_SIZE, required);
+            blocks.push_back(std::make_unique<char[]>(blockSize));
+            blockUsed = 0;
+            bytes += blockSize;
+        }
+        char* destination = blocks.back().get() + blockUsed;
+        std::memcpy(destination, text.data(), text.size());
+        destination[text.size()] = '\0';
+        blockUsed += required;
+        return destination;
+    }
+
+    void SymbolTable::grow(){
+        std::vector<Symbol> grown(slots.size() * 2, INVALID_SYMBOL);
+        const size_t mask = grown.size() - 1;
+        for (Symbol symbol = 0; symbol < entries.size(); ++symbol) {
+            size_t slot = entries[symbol].hash & mask;
+            while (grown[slot] != INVALID_SYMBOL) slot = (slot + 1) & mask;
+            grown[slot] = symbol;
+        }
+        slots.swap(grown);
+    }
+
+    Symbol SymbolTable::insertLocked(std::string_view text, uint64_t hash){
+        Symbol existing = findLocked(text, hash);
+        if (existing != INVALID_SYMBOL) return existing;
+
+        if ((entries.size() + 1) * 2 > slots.size()) grow();
+        const Symbol symbol = static_cast<Symbol>(entries.size());
+        entries.push_back({std::string_view(store(text), text.size()), hash});
+
+        const size_t mask = slots.size() - 1;
+        size_t slot = hash & mask;
+        while (slots[slot] != INVALID_SYMBOL) slot = (slot + 1) & mask;
+        slots[slot] = symbol;
+        return symbol;
+    }
+
+    Symbol SymbolTable::intern(std::string_view text){
+        const uint64_t hash = hashText(text);
+        if (!concurrent) return insertLocked(text, hash);
+        {
+            std::shared_lock lock(mutex);
+            Symbol symbol = findLocked(text, hash);
+            if (symbol != INVALID_SYMBOL) return symbol;
+        }
+        std::unique_lock lock(mutex);
+        return insertLocked(text, hash);
+    }
+
+    Symbol SymbolTable::find(std::string_view text) const{
+        const uint64_t hash = hashText(text);
+        if (!concurrent) return findLocked(text, hash);
+        std::shared_lock lock(mutex);
+        return findLocked(text, hash);
+    }
+
+    std::string_view SymbolTable::name(Symbol symbol) const{
+        if (!concurrent) return symbol < entries.size() ? entries[symbol].text : std::string_view{};
+        std::shared_lock lock(mutex);
+        return symbol < entries.size() ? entries[symbol].text : std::string_view{};
+    }
+
+    size_t SymbolTable::size() const{
+        if (!concurrent) return entries.size();
+        std::shared_lock lock(mutex);
+        return entries.size();
+    }
+
+    size_t SymbolTable::arenaBytes() const{
+        if (!concurrent) return bytes;
+        std::shared_lock lock(mutex);
+        return bytes;
+    }
+
+    SymbolTable& SymbolTable::global(){
+        static SymbolTable table(true);
+        return table;
+    }
+}
@@ -0,0 +1,233 @@
+#include <cmath>
+#include <algorithm>
+#include <numbers>
+#include <limits>
+#include <type_traits>
+#include <token_utils.h>
+#include <math_utils.h>
+
+namespace Utils::TokenUtils::Tokenizer
+{
+    namespace {
+        // rows per block, every stack slot gets one block of scratch so the working set stays in L1
+        constexpr size_t BATCH_BLOCK = 256;
+
+        float toRadians(float degrees) { return Utils::MathUtils::degtorad(degrees); }
+        double toRadians(double degrees) { return degrees * std::numbers::pi / 180.0; }
+
+        // a % b on the truncated operands, NaN where int arithmetic would trap or overflow
+        template<typename T>
+        T scalar_modulo(T a, T b) {
+            constexpr T limit = static_cast<T>(2147483648.0);
+            if (!(std::fabs(a) < limit) || !(std::fabs(b) < limit)) return std::numeric_limits<T>::quiet_NaN();
+            const int divisor = static_cast<int>(b);
+            if (divisor == 0) return std::numeric_limits<T>::quiet_NaN();
+            if (divisor == -1) return T(0);
+            return static_cast<T>(static_cast<int>(a) % divisor);
+        }
+
+        template<typename T>
+        T scalar_binary(OpCode op, T a, T b) {
+            switch (op) {
+                case OpCode::ADD: return a + b;
+                case OpCode::SUBTRACT: return a - b;
+                case OpCode::MULTIPLY: return a * b;
+                case OpCode::DIVIDE: return a / b;
+                case OpCode::MODULO: return scalar_modulo(a, b);
+                case OpCode::POWER: return std::pow(a, b);
+                case OpCode::MIN: return std::min(a, b);
+                case OpCode::MAX: return std::max(a, b);
+                default: return a;
+            }
+        }
+
+        template<typename T>
+        T scalar_unary(OpCode op, T a) {
+            switch (op) {
+                case OpCode::NEGATE: return -a;
+                case OpCode::SIN: return std::sin(toRadians(a));
+                case OpCode::COS: return std::cos(toRadians(a));
+                case OpCode::TAN: return std::tan(toRadians(a));
+                case OpCode::LOG: return std::log10(a);
+                case OpCode::SQRT: return std::sqrt(a);
+                case OpCode::ABS: return std::fabs(a);
+                default: return a;
+            }
+        }
+
+        template<typename T>
+        void binary_scalar(OpCode op, T* out, const T* a, const T* b, size_t count) {
+            for (size_t i = 0; i < count; ++i) out[i] = scalar_binary(op, a[i], b[i]);
+        }
+
+        template<typename T>
+        void unary_scalar(OpCode op, T* out, const T* a, size_t count) {
+            for (size_t i = 0; i < count; ++i) out[i] = scalar_unary(op, a[i]);
+        }
+
+        template<typename T> struct AVX2Lanes;
+
+        template<> struct AVX2Lanes<float> {
+            using Vector = __m256;
+            static constexpr size_t width = 8;
+            CAKILGAN_TARGET("avx2") static Vector load(const float* p) { return _mm256_loadu_ps(p); }
+            CAKILGAN_TARGET("avx2") static void store(float* p, Vector v) { _mm256_storeu_ps(p, v); }
+            CAKILGAN_TARGET("avx2") static Vector add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+            CAKILGAN_TARGET("avx2") static Vector sub(Vector a, Vector b) { return _mm256_sub_ps(a, b); }
+            CAKILGAN_TARGET("avx2") static Vector mul(Vector a, Vector b) { return _mm256_mul_ps(a, b); }
+            CAKILGAN_TARGET("avx2") static Vector div(Vector a, Vector b) { return _mm256_div_ps(a, b); }
+            // operands swapped so ties and NaNs resolve like std::min / std::max
+            CAKILGAN_TARGET("avx2") static Vector min(Vector a, Vector b) { return _mm256_min_ps(b, a); }
+            CAKILGAN_TARGET("avx2") static Vector max(Vector a, Vector b) { return _mm256_max_ps(b, a); }
+            CAKILGAN_TARGET("avx2") static Vector negate(Vector a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+            CAKILGAN_TARGET("avx2") static Vector abs(Vector a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+            CAKILGAN_TARGET("avx2") static Vector sqrt(Vector a) { return _mm256_sqrt_ps(a); }
+        };
+
+        template<> struct AVX2Lanes<double> {
+            using Vector = __m256d;
+            static constexpr size_t width = 4;
+            CAKILGAN_TARGET("avx2") static Vector load(const double* p) { return _mm256_loadu_pd(p); }
+            CAKILGAN_TARGET("avx2") static void store(double* p, Vector v) { _mm256_storeu_pd(p, v); }
+            CAKILGAN_TARGET("avx2") static Vector add(Vector a, Vector b) { return _mm256_add_pd(a, b); }
+            CAKILGAN_TARGET("avx2") static Vector sub(Vector a, Vector b) { return _mm256_sub_pd(a, b); }
+            CAKILGAN_TARGET("avx2") static Vector mul(Vector a, Vector b) { return _mm256_mul_pd(a, b); }
+            CAKILGAN_TARGET("avx2") static Vector div(Vector a, Vector b) { return _mm256_div_pd(a, b); }
+            CAKILGAN_TARGET("avx2") static Vector min(Vector a, Vector b) { return _mm256_min_pd(b, a); }
+            CAKILGAN_TARGET("avx2") static Vector max(Vector a, Vector b) { return _mm256_max_pd(b, a); }
+            CAKILGAN_TARGET("avx2") static Vector negate(Vector a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+            CAKILGAN_TARGET("avx2") static Vector abs(Vector a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+            CAKILGAN_TARGET("avx2") static Vector sqrt(Vector a) { return _mm256_sqrt_pd(a); }
+        };
+
+        // false when the operator has no vector form and needs the scalar loop
+        template<typename T>
+        CAKILGAN_TARGET("avx2")
+        bool binary_avx2(OpCode op, T* out, const T* a, const T* b, size_t count) {
+            using L = AVX2Lanes<T>;
+            size_t i = 0;
+            switch (op) {
+                case OpCode::ADD: for (; i + L::width <= count; i += L::width) L::store(out + i, L::add(L::load(a + i), L::load(b + i))); break;
+                case OpCode::SUBTRACT: for (; i + L::width <= count; i += L::width) L::store(out + i, L::sub(L::load(a + i), L::load(b + i))); break;
+                case OpCode::MULTIPLY: for (; i + L::width <= count; i += L::width) L::store(out + i, L::mul(L::load(a + i), L::load(b + i))); break;
+                case OpCode::DIVIDE: for (; i + L::width <= count; i += L::width) L::store(out + i, L::div(L::load(a + i), L::load(b + i))); break;
+                case OpCode::MIN: for (; i + L::width <= count; i += L::width) L::store(out + i, L::min(L::load(a + i), L::load(b + i))); break;
+                case OpCode::MAX: for (; i + L::width <= count; i += L::width) L::store(out + i, L::max(L::load(a + i), L::load(b + i))); break;
+                default: return false;
+            }
+            binary_scalar(op, out + i, a + i, b + i, count - i);
+            return true;
+        }
+
+        template<typename T>
+        CAKILGAN_TARGET("avx2")
+        bool unary_avx2(OpCode op, T* out, const T* a, size_t count) {
+            using L = AVX2Lanes<T>;
+            size_t i = 0;
+            switch (op) {
+                case OpCode::NEGATE: for (; i + L::width <= count; i += L::width) L::store(out + i, L::negate(L::load(a + i))); break;
+                case OpCode::ABS: for (; i + L::width <= count; i += L::width) L::store(out + i, L::abs(L::load(a + i))); break;
+                case OpCode::SQRT: for (; i + L::width <= count; i += L::width) L::store(out + i, L::sqrt(L::load(a + i))); break;
+                default: return false;
+            }
+            unary_scalar(op, out + i, a + i, count - i);
+            return true;
+        }
+
+        bool isBinary(OpCode op) {
+            switch (op) {
+                case OpCode::ADD:
+                case OpCode::SUBTRACT:
+                case OpCode::MULTIPLY:
+                case OpCode::DIVIDE:
+                case OpCode::MODULO:
+                case OpCode::POWER:
+                case OpCode::MIN:
+                case OpCode::MAX:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        template<typename T>
+        std::vector<T>& batchScratch() {
+            thread_local std::vector<T> scratch;
+            return scratch;
+        }
+    }
+
+    template<typename T>
+    void CompiledExpression::runBatch(std::span<const std::span<const T>> columns, std::span<T> output) const{
+        if (columns.size() < variableNames.size()) throw std::invalid_argument("unbound variables");
+        for (size_t i = 0; i < variableNames.size(); ++i) {
+            if (columns[i].size() < output.size()) throw std::invalid_argument("column " + variableNames[i] + " is shorter than the output");
+        }
+        if (program.empty()) return;
+
+        // AVX-512 machines reuse the AVX2 lanes, below AVX2 the scalar loops are left to the compiler
+        const bool vector = getSIMDLevel() >= SIMDLevel::AVX2;
+        // stack slots first, then one block per register
+        std::vector<T>& scratch = batchScratch<T>();
+        const size_t slots = maxDepth + registerCount;
+        if (scratch.size() < slots * BATCH_BLOCK) scratch.resize(slots * BATCH_BLOCK);
+        T* registerBlocks = scratch.data() + maxDepth * BATCH_BLOCK;
+
+        // variables are read from their columns in place, only results go to the slot's scratch block
+        const T* pointers[64];
+        std::vector<const T*> manyPointers;
+        const T** stack = pointers;
+        if (slots > std::size(pointers)) {
+            manyPointers.resize(slots);
+            stack = manyPointers.data();
+        }
+        const T** registers = stack + maxDepth;
+
+        for (size_t base = 0; base < output.size(); base += BATCH_BLOCK) {
+            const size_t count = std::min(BATCH_BLOCK, output.size() - base);
+            size_t top = 0;
+            for (const Instruction& instruction : program) {
+                if (instruction.op == OpCode::CONSTANT) {
+                    T* slot = scratch.data() + top * BATCH_BLOCK;
+                    if constexpr (std::is_same_v<T, double>) {
+                        std::fill(slot, slot + count, doubleConstantPool[instruction.operand]);
+                    } else {
+                        std::fill(slot, slot + count, constantPool[instruction.operand]);
+                    }
+                    stack[top++] = slot;
+                } else if (instruction.op == OpCode::VARIABLE) {
+                    stack[top++] = columns[instruction.operand].data() + base;
+                } else if (instruction.op == OpCode::LOAD) {
+                    stack[top++] = registers[instruction.operand];
+                } else if (instruction.op == OpCode::STORE) {
+                    // the stack slot gets overwritten later, so the register keeps its own copy
+                    T* block = registerBlocks + instruction.operand * BATCH_BLOCK;
+                    std::copy(stack[top - 1], stack[top - 1] + count, block);
+                    registers[instruction.operand] = block;
+                } else if (isBinary(instruction.op)) {
+                    --top;
+                    T* slot = scratch.data() + (top - 1) * BATCH_BLOCK;
+                    if (!vector || !binary_avx2(instruction.op, slot, stack[top - 1], stack[top], count)) {
+                        binary_scalar(instruction.op, slot, stack[top - 1], stack[top], count);
+                    }
+                    stack[top - 1] = slot;
+                } else {
+                    T* slot = scratch.data() + (top - 1) * BATCH_BLOCK;
+                    if (!vector || !unary_avx2(instruction.op, slot, stack[top - 1], count)) {
+                        unary_scalar(instruction.op, slot, stack[top - 1], count);
+                    }
+                    stack[top - 1] = slot;
+                }
+            }
+            std::copy(stack[0], stack[0] + count, output.data() + base);
+        }
+    }
+
+    void CompiledExpression::evaluateBatch(std::span<const std::span<const float>> columns, std::span<float> output) const{
+        runBatch(columns, output);
+    }
+
+    void CompiledExpression::evaluateBatch(std::span<const std::span<const double>> columns, std::span<double> output) const{
+        runBatch(columns, output);
+    }
+}
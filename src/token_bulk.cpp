@@ -0,0 +1,136 @@
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <token_utils.h>
+
+namespace Utils::TokenUtils::Tokenizer
+{
+    namespace {
+        // formulas taken from a lane at a time, small enough to balance and large enough to keep locks rare
+        constexpr size_t BULK_CHUNK = 32;
+
+        // every worker starts with an equal slice of the index space and steals half of the
+        // largest remaining slice once its own runs dry
+        class WorkStealingRanges {
+            public:
+            WorkStealingRanges(size_t count, size_t workers): lanes(workers) {
+                for (size_t i = 0; i < workers; ++i) {
+                    lanes[i].begin = count * i / workers;
+                    lanes[i].end = count * (i + 1) / workers;
+                }
+            }
+
+            bool next(size_t self, size_t& first, size_t& last) {
+                if (take(lanes[self], first, last)) return true;
+                while (steal(self)) {
+                    if (take(lanes[self], first, last)) return true;
+                }
+                return false;
+            }
+
+            private:
+            struct alignas(64) Lane {
+                std::mutex mutex;
+                size_t begin = 0;
+                size_t end = 0;
+            };
+
+            static bool take(Lane& lane, size_t& first, size_t& last) {
+                std::lock_guard lock(lane.mutex);
+                if (lane.begin == lane.end) return false;
+                first = lane.begin;
+                last = std::min(lane.end, lane.begin + BULK_CHUNK);
+                lane.begin = last;
+                return true;
+            }
+
+            bool steal(size_t self) {
+                size_t victim = self;
+                size_t largest = 0;
+                for (size_t i = 0; i < lanes.size(); ++i) {
+                    if (i == self) continue;
+                    std::lock_guard lock(lanes[i].mutex);
+                    if (lanes[i].end - lanes[i].begin > largest) {
+                        largest = lanes[i].end - lanes[i].begin;
+                        victim = i;
+                    }
+                }
+                if (victim == self) return false;
+
+                size_t stolenBegin, stolenEnd;
+                {
+                    std::lock_guard lock(lanes[victim].mutex);
+                    Lane& lane = lanes[victim];
+                    if (lane.begin == lane.end) return true;
+                    const size_t middle = lane.begin + (lane.end - lane.begin + 1) / 2;
+                    stolenBegin = middle;
+                    stolenEnd = lane.end;
+                    lane.end = middle;
+                    // a single chunk left, take it whole
+                    if (stolenBegin == stolenEnd) {
+                        stolenBegin = lane.begin;
+                        lane.end = lane.begin;
+                    }
+                }
+                std::lock_guard lock(lanes[self].mutex);
+                lanes[self].begin = stolenBegin;
+                lanes[self].end = stolenEnd;
+                return true;
+            }
+
+            std::vector<Lane> lanes;
+        };
+
+        template<typename Text>
+        BulkEvaluation evaluateAll(std::span<const Text> formulas, size_t threadCount) {
+            const auto start = std::chrono::steady_clock::now();
+            BulkEvaluation result;
+            result.values.resize(formulas.size());
+            result.errors.resize(formulas.size());
+
+            if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+            threadCount = std::max<size_t>(1, std::min(threadCount, (formulas.size() + BULK_CHUNK - 1) / BULK_CHUNK));
+            WorkStealingRanges ranges(formulas.size(), threadCount);
+            std::atomic<size_t> failures{0};
+
+            auto worker = [&](size_t self) {
+                ParseArena arena;
+                std::vector<WordSpan> words;
+                size_t first, last;
+                while (ranges.next(self, first, last)) {
+                    for (size_t i = first; i < last; ++i) {
+                        try {
+                            const std::string_view formula = formulas[i];
+                            words.clear();
+                            segmentWords(formula, words);
+                            result.values[i] = CompiledExpression::compile(formula, words, arena).evaluate();
+                        } catch (const std::exception& error) {
+                            result.values[i] = std::numeric_limits<float>::quiet_NaN();
+                            result.errors[i] = error.what();
+                            failures.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                }
+            };
+
+            {
+                std::vector<std::jthread> workers;
+                workers.reserve(threadCount - 1);
+                for (size_t i = 1; i < threadCount; ++i) workers.emplace_back(worker, i);
+                worker(0);
+            }
+
+            result.failures = failures.load();
+            result.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            return result;
+        }
+    }
+
+    BulkEvaluation bulkEvaluate(std::span<const std::string_view> formulas, size_t threadCount){
+        return evaluateAll(formulas, threadCount);
+    }
+
+    BulkEvaluation bulkEvaluate(std::span<const std::string> formulas, size_t threadCount){
+        return evaluateAll(formulas, threadCount);
+    }
+}
@@ -0,0 +1,742 @@
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <bit>
+#include <numbers>
+#include <limits>
+#include <token_utils.h>
+#include <math_utils.h>
+
+namespace Utils::TokenUtils::Tokenizer
+{
+    constexpr std::array<const char*, 19> opCodes = {
+        "CONSTANT",
+        "VARIABLE",
+        "LOAD",
+        "STORE",
+        "ADD",
+        "SUBTRACT",
+        "MULTIPLY",
+        "DIVIDE",
+        "MODULO",
+        "POWER",
+        "NEGATE",
+        "MIN",
+        "MAX",
+        "SIN",
+        "COS",
+        "TAN",
+        "LOG",
+        "SQRT",
+        "ABS"
+    };
+    const char* getEnumName(OpCode op){
+        return opCodes[static_cast<uint8_t>(op)];
+    }
+
+    struct FunctionInfo {
+        std::string_view name;
+        OpCode op;
+        size_t minArguments;
+        size_t maxArguments;
+    };
+    // min and max fold any number of arguments pairwise
+    constexpr std::array<FunctionInfo, 9> functions = {{
+        {"sin", OpCode::SIN, 1, 1},
+        {"cos", OpCode::COS, 1, 1},
+        {"tan", OpCode::TAN, 1, 1},
+        {"log", OpCode::LOG, 1, 1},
+        {"sqrt", OpCode::SQRT, 1, 1},
+        {"abs", OpCode::ABS, 1, 1},
+        {"pow", OpCode::POWER, 2, 2},
+        {"min", OpCode::MIN, 1, SIZE_MAX},
+        {"max", OpCode::MAX, 1, SIZE_MAX}
+    }};
+
+    class ExpressionParser{
+        public:
+        // the copy keeps the text null terminated for strtod
+        ExpressionParser(std::string_view source, std::span<const WordSpan> words, ParseArena& arena)
+            : text(source, arena.resource()), words(words), arena(arena) {}
+
+        Node* run(){
+            Node* root = expression(0);
+            if (const WordSpan* extra = peek()) unexpected(*extra);
+            return root;
+        }
+
+        private:
+        static constexpr int ADDITIVE = 10;
+        static constexpr int MULTIPLICATIVE = 20;
+        static constexpr int UNARY = 30;
+        static constexpr int EXPONENT = 40;
+
+        static bool isClass(char c, TokenType type){
+            return DEFAULT_CHAR_CLASSES.classify(c) == type;
+        }
+
+        std::string_view view(const WordSpan& word) const{
+            return word.view(text);
+        }
+
+        bool is(const WordSpan& word, char c) const{
+            return word.length == 1 && text[word.offset] == c;
+        }
+
+        const WordSpan* peek(){
+            while (position < words.size() && words[position].length == 1 && isClass(text[words[position].offset], TokenType::WHITESPACE)) ++position;
+            return position < words.size() ? &words[position] : nullptr;
+        }
+
+        [[noreturn]] void unexpected(const WordSpan& word){
+            throw std::invalid_argument("unexpected '" + std::string(view(word)) + "'");
+        }
+
+        void expect(char c, const char* what){
+            const WordSpan* word = peek();
+            if (!word || !is(*word, c)) throw std::invalid_argument(std::string("expected ") + what);
+            ++position;
+        }
+
+        int infixPower(const WordSpan& word) const{
+            if (is(word, '+') || is(word, '-')) return ADDITIVE;
+            if (is(word, '*') || is(word, '/') || is(word, '%')) return MULTIPLICATIVE;
+            if (is(word, '^')) return EXPONENT;
+            return 0;
+        }
+
+        // digits, or a '.' word followed by digits
+        bool startsNumber(const WordSpan& word) const{
+            const char first = is(word, '.') ? text[word.offset + 1] : text[word.offset];
+            return isClass(first, TokenType::NUMERIC);
+        }
+
+        bool isName(const WordSpan& word) const{
+            if (word.type == WordTokenTypes::ALL_ALPHA) return true;
+            if (word.type != WordTokenTypes::UNKNOWN || !isClass(text[word.offset], TokenType::ALPHABETIC)) return false;
+            return std::ranges::all_of(view(word), [](char c) { return isClass(c, TokenType::ALPHABETIC) || isClass(c, TokenType::NUMERIC); });
+        }
+
+        Node* expression(int minPower){
+            if (++depth > MAX_EXPRESSION_DEPTH) {
+                throw std::invalid_argument("expression nested deeper than " + std::to_string(MAX_EXPRESSION_DEPTH) + " levels");
+            }
+            Node* left = prefix();
+            while (const WordSpan* op = peek()) {
+                const int power = infixPower(*op);
+                if (power <= minPower) break;
+                ++position;
+                Node* node = arena.makeNode(view(*op));
+                node->left = left;
+                // ^ is right associative, so the right side may take another ^
+                node->right = expression(is(*op, '^') ? power - 1 : power);
+                left = node;
+            }
+            --depth;
+            return left;
+        }
+
+        Node* prefix(){
+            const WordSpan* word = peek();
+            if (!word) throw std::invalid_argument("missing operand");
+
+            if (is(*word, '(')) {
+                ++position;
+                Node* inner = expression(0);
+                expect(')', "')'");
+                return inner;
+            }
+            if (is(*word, '-')) {
+                ++position;
+                Node* node = arena.makeNode("-");
+                node->left = expression(UNARY);
+                return node;
+            }
+            if (startsNumber(*word)) return number();
+            if (isName(*word)) {
+                ++position;
+                const WordSpan* next = peek();
+                if (next && is(*next, '(')) return call(*word);
+                Node* leaf = arena.makeNode(view(*word));
+                leaf->kind = Node::Kind::VARIABLE;
+                return leaf;
+            }
+            if (word->type == WordTokenTypes::OPERATOR || infixPower(*word) || is(*word, ')') || is(*word, ',')) {
+                unexpected(*word);
+            }
+            throw std::invalid_argument("invalid operand " + std::string(view(*word)));
+        }
+
+        // 1.5e-3 is segmented as 1 . 5e - 3, the literal takes every word strtod reads and has to end with one
+        Node* number(){
+            const size_t begin = words[position].offset;
+            char* end = nullptr;
+            std::strtod(text.c_str() + begin, &end);
+            const size_t stop = static_cast<size_t>(end - text.c_str());
+            while (position < words.size() && words[position].offset < stop) ++position;
+            const WordSpan& last = words[position - 1];
+            const size_t wordEnd = last.offset + last.length;
+            if (wordEnd != stop) {
+                throw std::invalid_argument("invalid operand " + std::string(std::string_view(text).substr(begin, wordEnd - begin)));
+            }
+            Node* leaf = arena.makeNode(std::string_view(text).substr(begin, stop - begin));
+            leaf->kind = Node::Kind::NUMBER;
+            return leaf;
+        }
+
+        Node* call(const WordSpan& name){
+            Node* node = arena.makeNode(view(name));
+            node->kind = Node::Kind::CALL;
+            expect('(', "'('");
+            const WordSpan* next = peek();
+            if (next && is(*next, ')')) {
+                ++position;
+                return node;
+            }
+            while (true) {
+                node->arguments.push_back(expression(0));
+                next = peek();
+                if (next && is(*next, ',')) {
+                    ++position;
+                    continue;
+                }
+                expect(')', "')'");
+                return node;
+            }
+        }
+
+        std::pmr::string text;
+        std::span<const WordSpan> words;
+        ParseArena& arena;
+        size_t position = 0;
+        size_t depth = 0;
+    };
+
+    Node* parse(std::string_view source, std::span<const WordSpan> words, ParseArena& arena){
+        return ExpressionParser(source, words, arena).run();
+    }
+
+    // the words keep their own segmentation, only their text is laid out end to end
+    Node* parse(const std::vector<WordToken>& words, ParseArena& arena){
+        std::pmr::string source(arena.resource());
+        std::pmr::vector<WordSpan> spans(arena.resource());
+        spans.reserve(words.size());
+        for (const WordToken& word : words) {
+            spans.push_back({source.size(), static_cast<uint32_t>(word.characterTokens.size()), word.type});
+            for (const Token& token : word.characterTokens) source += token.literalValue;
+        }
+        return parse(source, spans, arena);
+    }
+
+    ParseArena::ParseArena(size_t initialBytes)
+        : initial(new std::byte[std::max<size_t>(initialBytes, 256)]), initialSize(std::max<size_t>(initialBytes, 256)) {
+        monotonic.emplace(initial.get(), initialSize, std::pmr::new_delete_resource());
+        counter.upstream = &*monotonic;
+    }
+
+    void* ParseArena::CountingResource::do_allocate(size_t size, size_t alignment){
+        bytes += size;
+        return upstream->allocate(size, alignment);
+    }
+
+    Node* ParseArena::makeNode(std::string_view value){
+        ++nodes;
+        void* memory = counter.allocate(sizeof(Node), alignof(Node));
+        return new (memory) Node(value, &counter);
+    }
+
+    void ParseArena::reset(){
+        peak = std::max(peak, counter.bytes);
+        monotonic.reset();
+        // grow the first buffer so a parse of the same size stays in one block
+        if (peak > initialSize) {
+            initialSize = std::bit_ceil(peak);
+            initial.reset(new std::byte[initialSize]);
+        }
+        monotonic.emplace(initial.get(), initialSize, std::pmr::new_delete_resource());
+        counter.upstream = &*monotonic;
+        counter.bytes = 0;
+        nodes = 0;
+    }
+
+    namespace {
+        float toRadians(float degrees) { return Utils::MathUtils::degtorad(degrees); }
+        double toRadians(double degrees) { return degrees * std::numbers::pi / 180.0; }
+    }
+
+    // the truncated operands have to fit an int and the divisor must not truncate to 0
+    template<typename T>
+    T modulo(T left, T right){
+        constexpr T limit = static_cast<T>(2147483648.0);
+        if (!(std::fabs(left) < limit) || !(std::fabs(right) < limit)) throw std::invalid_argument("% operand out of int range");
+        const int divisor = static_cast<int>(right);
+        if (divisor == 0) throw std::invalid_argument("% by zero");
+        return static_cast<T>(static_cast<int>(left) % divisor);
+    }
+
+    // float for evaluate, double for the constants folded for evaluateBatch on doubles
+    template<typename T>
+    T applyBinary(OpCode op, T left, T right){
+        switch (op) {
+            case OpCode::ADD: return left + right;
+            case OpCode::SUBTRACT: return left - right;
+            case OpCode::MULTIPLY: return left * right;
+            case OpCode::DIVIDE: return left / right;
+            case OpCode::MODULO: return modulo(left, right);
+            case OpCode::POWER: return std::pow(left, right);
+            case OpCode::MIN: return std::min(left, right);
+            case OpCode::MAX: return std::max(left, right);
+            default: throw std::invalid_argument(std::string("not a binary operator ") + getEnumName(op));
+        }
+    }
+
+    // ! trigonometric functions take degrees
+    template<typename T>
+    T applyUnary(OpCode op, T value){
+        switch (op) {
+            case OpCode::NEGATE: return -value;
+            case OpCode::SIN: return std::sin(toRadians(value));
+            case OpCode::COS: return std::cos(toRadians(value));
+            case OpCode::TAN: return std::tan(toRadians(value));
+            case OpCode::LOG: return std::log10(value);
+            case OpCode::SQRT: return std::sqrt(value);
+            case OpCode::ABS: return std::fabs(value);
+            default: throw std::invalid_argument(std::string("not a unary operator ") + getEnumName(op));
+        }
+    }
+
+    bool isBinaryOp(OpCode op){
+        switch (op) {
+            case OpCode::ADD:
+            case OpCode::SUBTRACT:
+            case OpCode::MULTIPLY:
+            case OpCode::DIVIDE:
+            case OpCode::MODULO:
+            case OpCode::POWER:
+            case OpCode::MIN:
+            case OpCode::MAX:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // turns a parse tree into a value numbered graph, equal subexpressions share one node when optimizing,
+    // then emits postfix code that keeps shared results in registers
+    class ExpressionBuilder{
+        public:
+        ExpressionBuilder(CompiledExpression& target, bool optimize, std::pmr::memory_resource* scratch)
+            : target(target), optimize(optimize), scratch(scratch), nodes(scratch), known(0, KeyHash{}, std::equal_to<Key>{}, scratch) {}
+
+        void build(const Node* root){
+            emitProgram(graph(root));
+        }
+
+        private:
+        static constexpr uint32_t NONE = UINT32_MAX;
+
+        struct GraphNode {
+            OpCode op;
+            uint32_t operand;
+            uint32_t left;
+            uint32_t right;
+            float constant;
+            double precise;
+        };
+
+        struct Key {
+            OpCode op;
+            uint32_t operand;
+            uint32_t left;
+            uint32_t right;
+            bool operator==(const Key& other) const = default;
+        };
+        struct KeyHash {
+            size_t operator()(const Key& key) const noexcept{
+                uint64_t h = static_cast<uint64_t>(key.op) * 0x9E3779B97F4A7C15ull;
+                h ^= (static_cast<uint64_t>(key.operand) + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2));
+                h ^= ((static_cast<uint64_t>(key.left) << 32 | key.right) + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2));
+                return static_cast<size_t>(h);
+            }
+        };
+
+        // exact in both precisions, so an identity never drops a constant the double program still needs
+        bool isConstant(uint32_t id, float value) const{
+            const GraphNode& node = nodes[id];
+            return node.op == OpCode::CONSTANT && node.constant == value && std::signbit(node.constant) == std::signbit(value) &&
+                   node.precise == value && std::signbit(node.precise) == std::signbit(value);
+        }
+
+        uint32_t intern(GraphNode node){
+            if (!optimize) {
+                nodes.push_back(node);
+                return static_cast<uint32_t>(nodes.size() - 1);
+            }
+            // constants are keyed by the bit patterns of both precisions
+            Key key{node.op, node.operand, node.left, node.right};
+            if (node.op == OpCode::CONSTANT) {
+                uint64_t bits;
+                std::memcpy(&key.operand, &node.constant, sizeof(key.operand));
+                std::memcpy(&bits, &node.precise, sizeof(bits));
+                key.left = static_cast<uint32_t>(bits >> 32);
+                key.right = static_cast<uint32_t>(bits);
+            }
+            auto found = known.find(key);
+            if (found != known.end()) return found->second;
+            nodes.push_back(node);
+            const uint32_t id = static_cast<uint32_t>(nodes.size() - 1);
+            known.emplace(key, id);
+            return id;
+        }
+
+        uint32_t constant(float value, double precise){
+            return intern({OpCode::CONSTANT, 0, NONE, NONE, value, precise});
+        }
+
+        uint32_t unary(OpCode op, uint32_t child){
+            if (optimize) {
+                const GraphNode& value = nodes[child];
+                if (value.op == OpCode::CONSTANT) return constant(applyUnary(op, value.constant), applyUnary(op, value.precise));
+                if (op == OpCode::NEGATE && nodes[child].op == OpCode::NEGATE) return nodes[child].left;
+            }
+            return intern({op, 0, child, NONE, 0.0f, 0.0});
+        }
+
+        uint32_t binary(OpCode op, uint32_t left, uint32_t right){
+            if (optimize) {
+                const GraphNode& a = nodes[left];
+                const GraphNode& b = nodes[right];
+                // a constant % 0 is reported while compiling, the double program gets NaN like evaluateBatch
+                if (a.op == OpCode::CONSTANT && b.op == OpCode::CONSTANT) {
+                    const float value = applyBinary(op, a.constant, b.constant);
+                    double precise = std::numeric_limits<double>::quiet_NaN();
+                    try {
+                        precise = applyBinary(op, a.precise, b.precise);
+                    } catch (const std::invalid_argument&) {}
+                    return constant(value, precise);
+                }
+                // only identities that hold for every float, x + 0 is kept because of -0
+                if (op == OpCode::SUBTRACT && isConstant(right, 0.0f)) return left;
+                if (op == OpCode::MULTIPLY && isConstant(right, 1.0f)) return left;
+                if (op == OpCode::MULTIPLY && isConstant(left, 1.0f)) return right;
+                if (op == OpCode::DIVIDE && isConstant(right, 1.0f)) return left;
+                if (op == OpCode::POWER && isConstant(right, 1.0f)) return left;
+                if ((op == OpCode::ADD || op == OpCode::MULTIPLY) && left > right) std::swap(left, right);
+            }
+            return intern({op, 0, left, right, 0.0f, 0.0});
+        }
+
+        uint32_t leaf(const Node* node){
+            if (node->kind == Node::Kind::VARIABLE) {
+                size_t index = target.variableIndex(node->value);
+                if (index == CompiledExpression::NO_VARIABLE) {
+                    index = target.variableNames.size();
+                    target.variableNames.emplace_back(node->value);
+                }
+                return intern({OpCode::VARIABLE, static_cast<uint32_t>(index), NONE, NONE, 0.0f, 0.0});
+            }
+
+            // strtof accepts what stof did, without the exceptions
+            char* end = nullptr;
+            errno = 0;
+            const float value = std::strtof(node->value.c_str(), &end);
+            if (end != node->value.c_str() + node->value.size() || node->value.empty() || errno == ERANGE) {
+                throw std::invalid_argument("invalid operand " + std::string(node->value));
+            }
+            return constant(value, std::strtod(node->value.c_str(), nullptr));
+        }
+
+        uint32_t combine(const Node* node, const uint32_t* children){
+            if (node->left && node->right) {
+                if (node->value == "+") return binary(OpCode::ADD, children[0], children[1]);
+                if (node->value == "-") return binary(OpCode::SUBTRACT, children[0], children[1]);
+                if (node->value == "*") return binary(OpCode::MULTIPLY, children[0], children[1]);
+                if (node->value == "/") return binary(OpCode::DIVIDE, children[0], children[1]);
+                if (node->value == "%") return binary(OpCode::MODULO, children[0], children[1]);
+                if (node->value == "^") return binary(OpCode::POWER, children[0], children[1]);
+                throw std::invalid_argument("invalid operator " + std::string(node->value));
+            }
+            if (node->left) return unary(OpCode::NEGATE, children[0]);
+            if (node->kind == Node::Kind::NUMBER || node->kind == Node::Kind::VARIABLE) return leaf(node);
+
+            auto function = std::find_if(functions.begin(), functions.end(), [&](const FunctionInfo& f) { return f.name == node->value; });
+            if (function == functions.end()) throw std::invalid_argument("unknown function " + std::string(node->value));
+            const size_t count = node->arguments.size();
+            if (count < function->minArguments || count > function->maxArguments) {
+                throw std::invalid_argument("wrong number of arguments for " + std::string(node->value));
+            }
+            if (!isBinaryOp(function->op)) return unary(function->op, children[0]);
+            // min and max fold from the right, like the stack code they used to emit, a single argument is its own result
+            uint32_t result = children[count - 1];
+            for (size_t i = count - 1; i-- > 0;) result = binary(function->op, children[i], result);
+            return result;
+        }
+
+        // post-order without recursion, generated expressions can nest deeper than the call stack allows
+        uint32_t graph(const Node* root){
+            struct Pending {
+                const Node* node;
+                size_t next;
+                size_t base;
+            };
+            std::pmr::vector<Pending> pending({{root, 0, 0}}, scratch);
+            std::pmr::vector<uint32_t> values(scratch);
+            while (!pending.empty()) {
+                Pending& top = pending.back();
+                const Node* node = top.node;
+                const Node* child = nullptr;
+                if (!node->arguments.empty()) {
+                    if (top.next < node->arguments.size()) child = node->arguments[top.next];
+                } else if (top.next == 0) {
+                    child = node->left;
+                } else if (top.next == 1) {
+                    child = node->right;
+                }
+
+                if (child) {
+                    ++top.next;
+                    pending.push_back({child, 0, values.size()});
+                    continue;
+                }
+                const size_t base = top.base;
+                pending.pop_back();
+                const uint32_t value = combine(node, values.data() + base);
+                values.resize(base);
+                values.push_back(value);
+            }
+            return values.back();
+        }
+
+        void emitProgram(uint32_t root){
+            std::pmr::vector<uint32_t> uses(nodes.size(), 0, scratch);
+            std::pmr::vector<bool> reached(nodes.size(), false, scratch);
+            std::pmr::vector<uint32_t> pending({root}, scratch);
+            reached[root] = true;
+            ++uses[root];
+            while (!pending.empty()) {
+                const GraphNode& node = nodes[pending.back()];
+                pending.pop_back();
+                for (uint32_t child : {node.left, node.right}) {
+                    if (child == NONE) continue;
+                    ++uses[child];
+                    if (!reached[child]) {
+                        reached[child] = true;
+                        pending.push_back(child);
+                    }
+                }
+            }
+
+            std::pmr::vector<uint32_t> registerOf(nodes.size(), NONE, scratch);
+            std::pmr::vector<uint32_t> constantIndex(nodes.size(), NONE, scratch);
+            std::pmr::vector<std::pair<uint32_t, bool>> work({{root, false}}, scratch);
+            while (!work.empty()) {
+                const auto [id, expanded] = work.back();
+                work.pop_back();
+                const GraphNode& node = nodes[id];
+                if (registerOf[id] != NONE) {
+                    target.emit(OpCode::LOAD, registerOf[id]);
+                    continue;
+                }
+                if (!expanded && node.left != NONE) {
+                    work.push_back({id, true});
+                    if (node.right != NONE) work.push_back({node.right, false});
+                    work.push_back({node.left, false});
+                    continue;
+                }
+
+                if (node.op == OpCode::CONSTANT) {
+                    if (constantIndex[id] == NONE) {
+                        constantIndex[id] = static_cast<uint32_t>(target.constantPool.size());
+                        target.constantPool.push_back(node.constant);
+                        target.doubleConstantPool.push_back(node.precise);
+                    }
+                    target.emit(OpCode::CONSTANT, constantIndex[id]);
+                    continue;
+                }
+                target.emit(node.op, node.operand);
+                if (uses[id] > 1 && node.op != OpCode::VARIABLE) {
+                    registerOf[id] = static_cast<uint32_t>(target.registerCount++);
+                    target.emit(OpCode::STORE, registerOf[id]);
+                }
+            }
+        }
+
+        CompiledExpression& target;
+        bool optimize;
+        std::pmr::memory_resource* scratch;
+        std::pmr::vector<GraphNode> nodes;
+        std::pmr::unordered_map<Key, uint32_t, KeyHash> known;
+    };
+
+    namespace {
+        ParseArena& threadArena(){
+            thread_local ParseArena arena;
+            return arena;
+        }
+    }
+
+    CompiledExpression CompiledExpression::compile(std::string_view source, bool optimize){
+        thread_local std::vector<WordSpan> words;
+        words.clear();
+        segmentWords(source, words);
+        return compile(source, words, threadArena(), optimize);
+    }
+
+    CompiledExpression CompiledExpression::compile(const std::vector<WordToken>& words, bool optimize){
+        return compile(words, threadArena(), optimize);
+    }
+
+    CompiledExpression CompiledExpression::compile(const std::vector<WordToken>& words, ParseArena& arena, bool optimize){
+        arena.reset();
+        CompiledExpression result;
+        ExpressionBuilder(result, optimize, arena.resource()).build(parse(words, arena));
+        return result;
+    }
+
+    CompiledExpression CompiledExpression::compile(std::string_view source, std::span<const WordSpan> words, ParseArena& arena, bool optimize){
+        arena.reset();
+        CompiledExpression result;
+        ExpressionBuilder(result, optimize, arena.resource()).build(parse(source, words, arena));
+        return result;
+    }
+
+    void CompiledExpression::emit(OpCode op, uint32_t operand){
+        program.push_back({op, operand});
+        if (op == OpCode::CONSTANT || op == OpCode::VARIABLE || op == OpCode::LOAD) {
+            maxDepth = std::max(maxDepth, ++depth);
+        } else if (isBinaryOp(op)) {
+            --depth;
+        }
+    }
+
+    ExpressionCache::ExpressionCache(size_t capacity): limit(std::max<size_t>(capacity, 1)) {}
+
+    std::shared_ptr<const CompiledExpression> ExpressionCache::get(std::string_view source){
+        {
+            std::lock_guard lock(mutex);
+            auto found = index.find(source);
+            if (found != index.end()) {
+                order.splice(order.begin(), order, found->second);
+                hitCount.fetch_add(1, std::memory_order_relaxed);
+                return found->second->second;
+            }
+        }
+        missCount.fetch_add(1, std::memory_order_relaxed);
+        // compiled outside the lock, a concurrent miss on the same text keeps whichever entry landed first
+        auto compiled = std::make_shared<const CompiledExpression>(CompiledExpression::compile(source));
+
+        std::lock_guard lock(mutex);
+        auto found = index.find(source);
+        if (found != index.end()) return found->second->second;
+        order.emplace_front(std::string(source), std::move(compiled));
+        index.emplace(order.front().first, order.begin());
+        if (order.size() > limit) {
+            index.erase(order.back().first);
+            order.pop_back();
+        }
+        return order.front().second;
+    }
+
+    void ExpressionCache::clear(){
+        std::lock_guard lock(mutex);
+        index.clear();
+        order.clear();
+    }
+
+    size_t ExpressionCache::size() const{
+        std::lock_guard lock(mutex);
+        return order.size();
+    }
+
+    ExpressionCache& ExpressionCache::global(){
+        static ExpressionCache cache;
+        return cache;
+    }
+
+    float basicParseAndEvaulateMathExpression(std::string_view text){
+        return ExpressionCache::global().get(text)->evaluate();
+    }
+
+    float basicParseAndEvaulateMathExpression(std::vector<WordToken> tokenizedText){
+        std::string text;
+        for (const WordToken& word : tokenizedText) text += word.text();
+        return basicParseAndEvaulateMathExpression(std::string_view(text));
+    }
+
+    size_t CompiledExpression::variableIndex(std::string_view name) const{
+        for (size_t i = 0; i < variableNames.size(); ++i) {
+            if (variableNames[i] == name) return i;
+        }
+        return NO_VARIABLE;
+    }
+
+    float CompiledExpression::evaluate(std::span<const float> values) const{
+        if (values.size() < variableNames.size()) throw std::invalid_argument("unbound variables");
+
+        // registers live right after the stack
+        float inlineSlots[48];
+        float* stack = inlineSlots;
+        if (maxDepth + registerCount > std::size(inlineSlots)) {
+            thread_local std::vector<float> deepSlots;
+            if (deepSlots.size() < maxDepth + registerCount) deepSlots.resize(maxDepth + registerCount);
+            stack = deepSlots.data();
+        }
+        float* registers = stack + maxDepth;
+
+        size_t top = 0;
+        for (const Instruction& instruction : program) {
+            switch (instruction.op) {
+                case OpCode::CONSTANT: stack[top++] = constantPool[instruction.operand]; break;
+                case OpCode::VARIABLE: stack[top++] = values[instruction.operand]; break;
+                case OpCode::LOAD: stack[top++] = registers[instruction.operand]; break;
+                case OpCode::STORE: registers[instruction.operand] = stack[top - 1]; break;
+                case OpCode::ADD: --top; stack[top - 1] = stack[top - 1] + stack[top]; break;
+                case OpCode::SUBTRACT: --top; stack[top - 1] = stack[top - 1] - stack[top]; break;
+                case OpCode::MULTIPLY: --top; stack[top - 1] = stack[top - 1] * stack[top]; break;
+                case OpCode::DIVIDE: --top; stack[top - 1] = stack[top - 1] / stack[top]; break;
+                case OpCode::NEGATE: stack[top - 1] = -stack[top - 1]; break;
+                default:
+                    if (isBinaryOp(instruction.op)) {
+                        --top;
+                        stack[top - 1] = applyBinary(instruction.op, stack[top - 1], stack[top]);
+                    } else {
+                        stack[top - 1] = applyUnary(instruction.op, stack[top - 1]);
+                    }
+                    break;
+            }
+        }
+        return stack[0];
+    }
+
+    float CompiledExpression::evaluate(std::initializer_list<std::pair<std::string_view, float>> bindings) const{
+        float inlineValues[16];
+        thread_local std::vector<float> manyValues;
+        float* values = inlineValues;
+        if (variableNames.size() > std::size(inlineValues)) {
+            if (manyValues.size() < variableNames.size()) manyValues.resize(variableNames.size());
+            values = manyValues.data();
+        }
+
+        for (size_t i = 0; i < variableNames.size(); ++i) {
+            auto binding = std::find_if(bindings.begin(), bindings.end(), [&](const auto& b) { return b.first == variableNames[i]; });
+            if (binding == bindings.end()) throw std::invalid_argument("unbound variable " + variableNames[i]);
+            values[i] = binding->second;
+        }
+        return evaluate(std::span<const float>(values, variableNames.size()));
+    }
+
+    std::string CompiledExpression::toString() const{
+        std::string result;
+        for (const Instruction& instruction : program) {
+            result += getEnumName(instruction.op);
+            if (instruction.op == OpCode::CONSTANT) result += " " + std::to_string(constantPool[instruction.operand]);
+            if (instruction.op == OpCode::VARIABLE) result += " " + variableNames[instruction.operand];
+            if (instruction.op == OpCode::LOAD || instruction.op == OpCode::STORE) result += " r" + std::to_string(instruction.operand);
+            result += "\n";
+        }
+        return result;
+    }
+}
@@ -0,0 +1,169 @@
+#include <token_utils.h>
+#include <time_utils.h>
+#include <stdexcept>
+#include <thread>
+#include <algorithm>
+#include <utility>
+#include <exception>
+#include <mutex>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Utils::TokenUtils::Tokenizer
+{
+    MappedFile::MappedFile(const std::string& path){
+    #if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("can not open " + path);
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            throw std::runtime_error("can not stat " + path);
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+        if (size != 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+    #else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("can not open " + path);
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("can not stat " + path);
+        }
+        size = static_cast<size_t>(info.st_size);
+        if (size != 0) {
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                data = static_cast<const char*>(mapped);
+                madvise(mapped, size, MADV_SEQUENTIAL);
+            }
+        }
+        ::close(fd);
+    #endif
+        if (size != 0 && !data) throw std::runtime_error("can not map " + path);
+    }
+
+    MappedFile::~MappedFile(){
+        unmap();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+        : data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)) {}
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept{
+        if (this != &other) {
+            unmap();
+            data = std::exchange(other.data, nullptr);
+            size = std::exchange(other.size, 0);
+        }
+        return *this;
+    }
+
+    void MappedFile::unmap(){
+        if (!data) return;
+    #if defined(_WIN32)
+        UnmapViewOfFile(data);
+    #else
+        munmap(const_cast<char*>(data), size);
+    #endif
+        data = nullptr;
+        size = 0;
+    }
+
+    namespace {
+        // in UTF-8 mode bounds only land on the first byte of a separator codepoint
+        bool splitsAt(std::string_view input, size_t index, const CharClassifier& classes){
+            if (classes.utf8 && (static_cast<unsigned char>(input[index]) & 0xC0) == 0x80) return false;
+            return CharClassifier::isSeparator(Utf8::classifyAt(input, index, classes));
+        }
+
+        std::vector<size_t> splitOnSeparators(std::string_view input, size_t parts, const CharClassifier& classes){
+            std::vector<size_t> bounds{0};
+            for (size_t i = 1; i < parts; ++i) {
+                size_t bound = std::max(bounds.back(), input.size() * i / parts);
+                while (bound < input.size() && !splitsAt(input, bound, classes)) ++bound;
+                if (bound >= input.size()) break;
+                if (bound > bounds.back()) bounds.push_back(bound);
+            }
+            bounds.push_back(input.size());
+            return bounds;
+        }
+    }
+
+    FileTokenization parallelTokenizeFile(const std::string& path, size_t threadCount, bool merge, const CharClassifier& classes){
+        FileTokenization result{MappedFile(path), {}, {}, {}};
+        const std::string_view input = result.file.view();
+        if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+        const std::vector<size_t> bounds = splitOnSeparators(input, threadCount, classes);
+        const size_t segmentCount = bounds.size() - 1;
+        result.segments.resize(segmentCount);
+        if (merge) result.tokens.resize(input.size());
+
+        // an exception leaving a jthread would terminate, the first one is rethrown after the join
+        auto runParallel = [segmentCount](auto&& task) {
+            std::exception_ptr failure;
+            std::mutex failureMutex;
+            auto guarded = [&](size_t index) {
+                try {
+                    task(index);
+                } catch (...) {
+                    std::lock_guard lock(failureMutex);
+                    if (!failure) failure = std::current_exception();
+                }
+            };
+            {
+                std::vector<std::jthread> workers;
+                workers.reserve(segmentCount - 1);
+                for (size_t i = 1; i < segmentCount; ++i) workers.emplace_back(guarded, i);
+                guarded(0);
+            }
+            if (failure) std::rethrow_exception(failure);
+        };
+
+        runParallel([&](size_t index) {
+            PROFILE_SCOPE_CATEGORY("tokenizeFile::segment", TOKENIZER);
+            FileSegment& segment = result.segments[index];
+            segment.offset = bounds[index];
+            segment.length = bounds[index + 1] - bounds[index];
+            const std::string_view part = input.substr(segment.offset, segment.length);
+            if (merge) {
+                SIMDTokenize(part, result.tokens.data() + segment.offset, classes);
+            } else {
+                SIMDTokenize(part, segment.tokens, classes);
+            }
+            segmentWords(part, segment.words, classes);
+            for (WordSpan& span : segment.words) span.offset += segment.offset;
+        });
+
+        if (merge) {
+            std::vector<size_t> wordOffsets(segmentCount + 1, 0);
+            for (size_t i = 0; i < segmentCount; ++i) {
+                wordOffsets[i + 1] = wordOffsets[i] + result.segments[i].words.size();
+            }
+            result.words.resize(wordOffsets.back());
+            runParallel([&](size_t index) {
+                std::vector<WordSpan>& words = result.segments[index].words;
+                std::copy(words.begin(), words.end(), result.words.begin() + wordOffsets[index]);
+                std::vector<WordSpan>().swap(words);
+            });
+            result.segments.clear();
+        }
+        return result;
+    }
+}
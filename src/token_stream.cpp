@@ -0,0 +1,109 @@
+#include <token_utils.h>
+#include <time_utils.h>
+
+namespace Utils::TokenUtils::Tokenizer
+{
+    namespace {
+        WordTokenType mergeWordTypes(const WordTokenType& left, const WordTokenType& right){
+            return left == right ? left : WordTokenTypes::UNKNOWN;
+        }
+    }
+
+    StreamTokenizer::StreamTokenizer(WordConsumer onWord, TokenConsumer onTokens, const CharClassifier& classes)
+        : onWord(std::move(onWord)), onTokens(std::move(onTokens)), classes(classes) {}
+
+    void StreamTokenizer::emitCarry(){
+        if (carry.empty()) return;
+        onWord(WordSpan{carryOffset, static_cast<uint32_t>(carry.size()), carryType}, carry);
+        carry.clear();
+    }
+
+    void StreamTokenizer::feed(std::string_view chunk){
+        if (chunk.empty()) return;
+        PROFILE_SCOPE_CATEGORY("StreamTokenizer::feed", TOKENIZER);
+        if (!classes.utf8) {
+            process(chunk);
+            return;
+        }
+
+        // a sequence cut by the previous chunk is finished first, chunks are then only split between characters
+        if (!pending.empty()) {
+            size_t taken = 0;
+            while (taken < chunk.size() && Utf8::incompleteSuffix(pending) && (static_cast<unsigned char>(chunk[taken]) & 0xC0) == 0x80) {
+                pending += chunk[taken++];
+            }
+            if (taken == chunk.size() && Utf8::incompleteSuffix(pending)) return;
+            process(pending);
+            pending.clear();
+            chunk.remove_prefix(taken);
+        }
+        const size_t cut = chunk.size() - Utf8::incompleteSuffix(chunk);
+        process(chunk.substr(0, cut));
+        pending.assign(chunk.substr(cut));
+    }
+
+    void StreamTokenizer::process(std::string_view chunk){
+        if (chunk.empty()) return;
+
+        if (onTokens) {
+            SIMDTokenize(chunk, tokens, classes);
+            onTokens(tokens, position);
+        }
+
+        spans.clear();
+        segmentWords(chunk, spans, classes);
+
+        size_t first = 0;
+        if (!carry.empty()) {
+            if (CharClassifier::isSeparator(Utf8::classifyAt(chunk, 0, classes))) {
+                emitCarry();
+            } else if (spans.front().length == chunk.size()) {
+                carry.append(chunk);
+                carryType = mergeWordTypes(carryType, spans.front().type);
+                position += chunk.size();
+                return;
+            } else {
+                carry.append(spans.front().view(chunk));
+                carryType = mergeWordTypes(carryType, spans.front().type);
+                emitCarry();
+                first = 1;
+            }
+        }
+
+        size_t last = spans.size();
+        if (last > first && !CharClassifier::isSeparator(Utf8::classifyAt(chunk, Utf8::lastCharacter(chunk), classes))) {
+            const WordSpan& tail = spans.back();
+            carry.assign(tail.view(chunk));
+            carryType = tail.type;
+            carryOffset = position + tail.offset;
+            --last;
+        }
+
+        for (size_t i = first; i < last; ++i) {
+            WordSpan span = spans[i];
+            std::string_view word = span.view(chunk);
+            span.offset += position;
+            onWord(span, word);
+        }
+        position += chunk.size();
+    }
+
+    void StreamTokenizer::finish(){
+        process(pending);
+        pending.clear();
+        emitCarry();
+    }
+
+    void tokenizeStream(std::istream& input, const StreamTokenizer::WordConsumer& onWord,
+                        const StreamTokenizer::TokenConsumer& onTokens, size_t chunkSize, const CharClassifier& classes){
+        StreamTokenizer tokenizer(onWord, onTokens, classes);
+        std::vector<char> buffer(chunkSize);
+        while (input) {
+            input.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            const auto count = static_cast<size_t>(input.gcount());
+            if (count == 0) break;
+            tokenizer.feed(std::string_view(buffer.data(), count));
+        }
+        tokenizer.finish();
+    }
+}
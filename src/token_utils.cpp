@@ -1,7 +1,15 @@
 #include <cstring>
-#include <map>
+#include <cstddef>
+#include <atomic>
+#include <algorithm>
+#include <bit>
 #include <token_utils.h>
-#include <math_utils.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
 
 namespace Utils::TokenUtils
 {
@@ -17,34 +25,43 @@ namespace Utils::TokenUtils
     const char* getEnumName(TokenType tokenType){
         return tokenTypes[static_cast<uint8_t>(tokenType)];
     }
-    namespace Tokenizer{
-        
-        constexpr TokenType make_lookup_entry(char c) noexcept {
-            if (c >= '0' && c <= '9') return TokenType::NUMERIC;
-            if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) return TokenType::ALPHABETIC;
-        
-            switch (c) {
-                case ' ': case '\t': case '\r': case '\f': case '\v': return TokenType::WHITESPACE;
-                case '\n': return TokenType::NEWLINE;
-                case '.': case ',': case ';': case ':': case '!': case '?': case '-': case '\'':
-                case '"': case '(': case ')': case '[': case ']': case '{': case '}': case '/':
-                case '\\': case '@': case '#': case '$': case '%': case '^': case '&': case '*':
-                case '+': case '=': case '<': case '>': case '|': case '~': case '`': case '_':
-                    return TokenType::PUNCTUATION;
-                default: return TokenType::UNKNOWN;
+    constexpr std::array<const char*, 4> simdLevels = {
+        "SCALAR",
+        "SSE42",
+        "AVX2",
+        "AVX512BW"
+    };
+    const char* getEnumName(SIMDLevel level){
+        return simdLevels[static_cast<uint8_t>(level)];
+    }
+    Utils::SymbolUtils::SymbolTable& wordTypeTable(){
+        static Utils::SymbolUtils::SymbolTable& table = []() -> Utils::SymbolUtils::SymbolTable& {
+            static Utils::SymbolUtils::SymbolTable types(true);
+            for (const WordTokenType& builtin : {WordTokenTypes::UNKNOWN, WordTokenTypes::ALL_NUMBER, WordTokenTypes::ALL_ALPHA, WordTokenTypes::OPERATOR}) {
+                types.intern(builtin.tokenTypeName);
             }
+            return types;
+        }();
+        return table;
+    }
+    WordTokenType::WordTokenType(const char* tokenTypeName)
+        : id(wordTypeTable().intern(tokenTypeName)){
+        this->tokenTypeName = wordTypeTable().name(id).data();
+    }
+    namespace Tokenizer{
+        TokenType getTokenType(char c){
+            return DEFAULT_CHAR_CLASSES.classify(c);
         }
-        
-        constexpr auto make_lookup() noexcept {
-            std::array<TokenType, 256> arr{};
-            for (int i = 0; i < 256; ++i) {
-                arr[i] = make_lookup_entry(static_cast<char>(i));
+        void tokenize_scalar(const char* ptr, size_t size, Token* out, const CharClassifier& classes);
+        void tokenize_utf8(const char* ptr, size_t size, Token* out, const CharClassifier& classes,
+                           void (*asciiKernel)(const char*, size_t, Token*, const CharClassifier&));
+
+        std::vector<Token> defaultTokenize(std::string_view input, const CharClassifier& classes){
+            if (classes.utf8) {
+                std::vector<Token> tokens(input.size());
+                tokenize_utf8(input.data(), input.size(), tokens.data(), classes, tokenize_scalar);
+                return tokens;
             }
-            return arr;
-        }
-        
-        inline constexpr std::array<TokenType, 256> lookup = make_lookup();
-        std::vector<Token> defaultTokenize(std::string_view input){
             std::vector<Token> tokens;
             tokens.reserve(input.size());  
             
@@ -52,318 +69,456 @@ namespace Utils::TokenUtils
             const char* end = ptr + input.size();
             while (ptr != end) {
                 const auto c = static_cast<unsigned char>(*ptr++);
-                tokens.emplace_back(lookup[c], c);
+                tokens.emplace_back(classes.table[c], c);
             }
             
             return tokens;
         }
-        void process_chunk(const char* ptr, Token* out) {
-            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
-        
-            auto is_between = [](char lo, char hi, __m128i c) -> __m128i {
-                return _mm_and_si128(
-                    _mm_cmpgt_epi8(c, _mm_set1_epi8(lo - 1)),
-                    _mm_cmplt_epi8(c, _mm_set1_epi8(hi + 1))
-                );
-            };
-        
-            __m128i is_digit = is_between('0', '9', c);
-            __m128i is_upper = is_between('A', 'Z', c);
-            __m128i is_lower = is_between('a', 'z', c);
-            
-
-            __m128i p0 = is_between('!', '/', c);
-            __m128i p1 = is_between(':', '?', c);
-            __m128i p2 = is_between('[', '`', c);
-            __m128i p3 = is_between('{', '~', c);
+        // kernels store Tokens directly as interleaved {type, char} byte pairs
+        static_assert(sizeof(Token) == 2 && offsetof(Token, tokenType) == 0 && offsetof(Token, literalValue) == 1);
 
-            __m128i is_punctuation = _mm_or_si128(p0, _mm_or_si128(p1, _mm_or_si128(p2, p3)));
+        // one bit per byte of a 64 byte block
+        struct ClassMasks {
+            uint64_t separator;
+            uint64_t numeric;
+            uint64_t alphabetic;
+        };
 
+        void tokenize_scalar(const char* ptr, size_t size, Token* out, const CharClassifier& classes) {
+            for (size_t i = 0; i < size; ++i) {
+                out[i] = Token(classes.classify(ptr[i]), ptr[i]);
+            }
+        }
 
-            __m128i is_alpha = _mm_or_si128(is_upper, is_lower);
-            
-        
-            __m128i is_space = _mm_or_si128(
-                _mm_cmpeq_epi8(c, _mm_set1_epi8(' ')),
-                _mm_cmpeq_epi8(c, _mm_set1_epi8('\t'))
-            );
-            __m128i is_newline = _mm_cmpeq_epi8(c, _mm_set1_epi8('\n'));
-        
-            // mask to bitmask
-            int alpha_mask = _mm_movemask_epi8(is_alpha);
-            int digit_mask = _mm_movemask_epi8(is_digit);
-            int space_mask = _mm_movemask_epi8(is_space);
-            int newline_mask = _mm_movemask_epi8(is_newline);
-            int punctuation_mask = _mm_movemask_epi8(is_punctuation);
-        
-            for (int i = 0; i < 16; ++i) {
-                TokenType t;
-                if ((digit_mask >> i) & 1) t = TokenType::NUMERIC;
-                else if ((alpha_mask >> i) & 1) t = TokenType::ALPHABETIC;
-                else if ((space_mask >> i) & 1) t = TokenType::WHITESPACE;
-                else if ((newline_mask >> i) & 1) t = TokenType::NEWLINE;
-                else if ((punctuation_mask >> i) & 1) t = TokenType::PUNCTUATION;
-                else t = TokenType::UNKNOWN;
-        
-                out[i] = Token(t, ptr[i]);
+        void masks_scalar(const char* block, ClassMasks& masks, const CharClassifier& classes) {
+            masks = {};
+            for (int i = 0; i < 64; ++i) {
+                const TokenType t = classes.classify(block[i]);
+                const uint64_t bit = uint64_t{1} << i;
+                if (t == TokenType::WHITESPACE || t == TokenType::PUNCTUATION) masks.separator |= bit;
+                if (t == TokenType::NUMERIC) masks.numeric |= bit;
+                if (t == TokenType::ALPHABETIC) masks.alphabetic |= bit;
             }
         }
-       
-        std::vector<Token> SIMDTokenize(std::string_view input){
-            std::vector<Token> tokens(input.size());
-    
-            const char* data = input.data();
-            size_t size = input.size();
-            
+
+        struct SSE42Classifier {
+            __m128i rows, plane0, plane1, plane2, fallback, lowNibble;
+
+            CAKILGAN_TARGET("sse4.2")
+            explicit SSE42Classifier(const SIMDClassTables& tables)
+                : rows(_mm_load_si128(reinterpret_cast<const __m128i*>(tables.rowBits.data()))),
+                  plane0(_mm_load_si128(reinterpret_cast<const __m128i*>(tables.planes[0].data()))),
+                  plane1(_mm_load_si128(reinterpret_cast<const __m128i*>(tables.planes[1].data()))),
+                  plane2(_mm_load_si128(reinterpret_cast<const __m128i*>(tables.planes[2].data()))),
+                  fallback(_mm_set1_epi8(static_cast<char>(tables.fallback))),
+                  lowNibble(_mm_set1_epi8(0x0F)) {}
+
+            CAKILGAN_TARGET("sse4.2")
+            __m128i classify(__m128i c) const {
+                const __m128i zero = _mm_setzero_si128();
+                __m128i row = _mm_shuffle_epi8(rows, _mm_and_si128(_mm_srli_epi16(c, 4), lowNibble));
+
+                __m128i bit0 = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_and_si128(_mm_shuffle_epi8(plane0, c), row), zero), _mm_set1_epi8(1));
+                __m128i bit1 = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_and_si128(_mm_shuffle_epi8(plane1, c), row), zero), _mm_set1_epi8(2));
+                __m128i bit2 = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_and_si128(_mm_shuffle_epi8(plane2, c), row), zero), _mm_set1_epi8(4));
+                return _mm_xor_si128(_mm_or_si128(bit0, _mm_or_si128(bit1, bit2)), fallback);
+            }
+        };
+
+        CAKILGAN_TARGET("sse4.2")
+        void tokenize_sse42(const char* ptr, size_t size, Token* out, const CharClassifier& classes) {
+            const SSE42Classifier classifier(classes.simd);
             size_t i = 0;
             for (; i + 16 <= size; i += 16) {
-                process_chunk(data + i, &tokens[i]);
+                __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + i));
+                __m128i type = classifier.classify(c);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi8(type, c));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_unpackhi_epi8(type, c));
             }
-            
-            for (size_t j = 0; j < size - i; ++j) {
-                char c = data[i + j];
-                TokenType t;
-                t  = lookup[c];
-                tokens[i + j] = Token(t, c);
+            tokenize_scalar(ptr + i, size - i, out + i, classes);
+        }
+
+        CAKILGAN_TARGET("sse4.2")
+        void masks_sse42(const char* block, ClassMasks& masks, const CharClassifier& classes) {
+            const SSE42Classifier classifier(classes.simd);
+            masks = {};
+            for (int i = 0; i < 4; ++i) {
+                __m128i type = classifier.classify(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16)));
+                const int shift = i * 16;
+                __m128i separator = _mm_or_si128(_mm_cmpeq_epi8(type, _mm_set1_epi8(static_cast<char>(TokenType::WHITESPACE))),
+                                                 _mm_cmpeq_epi8(type, _mm_set1_epi8(static_cast<char>(TokenType::PUNCTUATION))));
+                masks.separator |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(separator))) << shift;
+                masks.numeric |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(type, _mm_set1_epi8(static_cast<char>(TokenType::NUMERIC)))))) << shift;
+                masks.alphabetic |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(type, _mm_set1_epi8(static_cast<char>(TokenType::ALPHABETIC)))))) << shift;
             }
-            
-            return tokens;
         }
 
+        struct AVX2Classifier {
+            __m256i rows, plane0, plane1, plane2, fallback, lowNibble;
 
+            CAKILGAN_TARGET("avx2")
+            static __m256i broadcast(const std::array<uint8_t, 16>& table) {
+                return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table.data())));
+            }
 
-        bool isAllNum(const std::vector<Utils::TokenUtils::Token>& tokens) {
-            for (const auto& token : tokens) {
-                if (token.tokenType != Utils::TokenUtils::TokenType::NUMERIC) {
-                    return false;
-                }
+            CAKILGAN_TARGET("avx2")
+            explicit AVX2Classifier(const SIMDClassTables& tables)
+                : rows(broadcast(tables.rowBits)),
+                  plane0(broadcast(tables.planes[0])),
+                  plane1(broadcast(tables.planes[1])),
+                  plane2(broadcast(tables.planes[2])),
+                  fallback(_mm256_set1_epi8(static_cast<char>(tables.fallback))),
+                  lowNibble(_mm256_set1_epi8(0x0F)) {}
+
+            CAKILGAN_TARGET("avx2")
+            __m256i classify(__m256i c) const {
+                const __m256i zero = _mm256_setzero_si256();
+                __m256i row = _mm256_shuffle_epi8(rows, _mm256_and_si256(_mm256_srli_epi16(c, 4), lowNibble));
+
+                __m256i bit0 = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_and_si256(_mm256_shuffle_epi8(plane0, c), row), zero), _mm256_set1_epi8(1));
+                __m256i bit1 = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_and_si256(_mm256_shuffle_epi8(plane1, c), row), zero), _mm256_set1_epi8(2));
+                __m256i bit2 = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_and_si256(_mm256_shuffle_epi8(plane2, c), row), zero), _mm256_set1_epi8(4));
+                return _mm256_xor_si256(_mm256_or_si256(bit0, _mm256_or_si256(bit1, bit2)), fallback);
             }
-            return true;
+        };
+
+        CAKILGAN_TARGET("avx2")
+        void tokenize_avx2(const char* ptr, size_t size, Token* out, const CharClassifier& classes) {
+            const AVX2Classifier classifier(classes.simd);
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32) {
+                __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr + i));
+                __m256i type = classifier.classify(c);
+                __m256i lo = _mm256_unpacklo_epi8(type, c);
+                __m256i hi = _mm256_unpackhi_epi8(type, c);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permute2x128_si256(lo, hi, 0x20));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+            }
+            tokenize_scalar(ptr + i, size - i, out + i, classes);
         }
-        bool isAllAlpha(const std::vector<Utils::TokenUtils::Token>& tokens) {
-            for (const auto& token : tokens) {
-                if (token.tokenType != Utils::TokenUtils::TokenType::ALPHABETIC) {
-                    return false;
-                }
+
+        CAKILGAN_TARGET("avx2")
+        void masks_avx2(const char* block, ClassMasks& masks, const CharClassifier& classes) {
+            const AVX2Classifier classifier(classes.simd);
+            masks = {};
+            for (int i = 0; i < 2; ++i) {
+                __m256i type = classifier.classify(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i * 32)));
+                const int shift = i * 32;
+                __m256i separator = _mm256_or_si256(_mm256_cmpeq_epi8(type, _mm256_set1_epi8(static_cast<char>(TokenType::WHITESPACE))),
+                                                    _mm256_cmpeq_epi8(type, _mm256_set1_epi8(static_cast<char>(TokenType::PUNCTUATION))));
+                masks.separator |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(separator))) << shift;
+                masks.numeric |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(type, _mm256_set1_epi8(static_cast<char>(TokenType::NUMERIC)))))) << shift;
+                masks.alphabetic |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(type, _mm256_set1_epi8(static_cast<char>(TokenType::ALPHABETIC)))))) << shift;
             }
-            return true;
         }
-        std::vector<WordToken> spaceAndPunctuationWordTokenize(std::vector<Token> tokens){
-            std::vector<WordToken> words;
-            std::vector<Utils::TokenUtils::Token> current;
-            int currentToken = 0;
-            for (auto& token : tokens) {
-                if(token.tokenType==Utils::TokenUtils::TokenType::WHITESPACE||token.tokenType==Utils::TokenUtils::TokenType::PUNCTUATION){
-                    if(!current.empty()){
-                        if(isAllNum(current)){
-                            words.push_back(Utils::TokenUtils::WordToken(current,{"ALL_NUMBER"}));
-                        }
-                        else if(isAllAlpha(current)){
-                            words.push_back(Utils::TokenUtils::WordToken(current,{"ALL_ALPHA"}));
-                        }
-                        else{
-                            words.push_back(Utils::TokenUtils::WordToken(current));
-                        }
-                    }
-                    current.clear();
-        
-                    current.push_back(token);
-                    if(!current.empty()){
-                        if(current.size()==1){
-                            if(current[0].literalValue=='+'||current[0].literalValue=='-'||current[0].literalValue=='*'||current[0].literalValue=='/'||current[0].literalValue=='%'){
-                                words.push_back(Utils::TokenUtils::WordToken(current,{"OPERATOR"}));
-                            }else{
-                            words.push_back(Utils::TokenUtils::WordToken(current));
-                            }
-                        }else{
-                            words.push_back(Utils::TokenUtils::WordToken(current));
-                        }
-                        
-                    }
-                    current.clear();
-        
-                }else if(currentToken==tokens.size()-1){
-                    current.push_back(token);
-                    if(!current.empty()){
-                        words.push_back(Utils::TokenUtils::WordToken(current));
-                    }
-                    current.clear();
-                }
-                else{
-                    current.push_back(token);
-                }
-                currentToken++;
+
+        struct AVX512BWClassifier {
+            __m512i rows, plane0, plane1, plane2, fallback, lowNibble;
+
+            CAKILGAN_TARGET("avx512f,avx512bw")
+            static __m512i broadcast(const std::array<uint8_t, 16>& table) {
+                // the unmasked form starts from _mm512_undefined_epi32, which GCC 12 flags under -Wuninitialized
+                const __m128i row = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table.data()));
+                return _mm512_maskz_broadcast_i32x4(0xFFFF, row);
             }
 
-            return words;
-        }
-        struct Node {
-            std::vector<Utils::TokenUtils::WordToken> words;
-            std::string value;
-            Node* left = nullptr;
-            Node* right = nullptr;
-            Node(const std::string& v) {
-                value = v;
+            CAKILGAN_TARGET("avx512f,avx512bw")
+            explicit AVX512BWClassifier(const SIMDClassTables& tables)
+                : rows(broadcast(tables.rowBits)),
+                  plane0(broadcast(tables.planes[0])),
+                  plane1(broadcast(tables.planes[1])),
+                  plane2(broadcast(tables.planes[2])),
+                  fallback(_mm512_set1_epi8(static_cast<char>(tables.fallback))),
+                  lowNibble(_mm512_set1_epi8(0x0F)) {}
+
+            CAKILGAN_TARGET("avx512f,avx512bw")
+            __m512i classify(__m512i c) const {
+                __m512i row = _mm512_shuffle_epi8(rows, _mm512_and_si512(_mm512_srli_epi16(c, 4), lowNibble));
+
+                __mmask64 bit0 = _mm512_test_epi8_mask(_mm512_shuffle_epi8(plane0, c), row);
+                __mmask64 bit1 = _mm512_test_epi8_mask(_mm512_shuffle_epi8(plane1, c), row);
+                __mmask64 bit2 = _mm512_test_epi8_mask(_mm512_shuffle_epi8(plane2, c), row);
+                __m512i type = _mm512_or_si512(_mm512_maskz_mov_epi8(bit0, _mm512_set1_epi8(1)),
+                    _mm512_or_si512(_mm512_maskz_mov_epi8(bit1, _mm512_set1_epi8(2)), _mm512_maskz_mov_epi8(bit2, _mm512_set1_epi8(4))));
+                return _mm512_xor_si512(type, fallback);
             }
         };
-        int lastGlobalOperator(std::vector<Utils::TokenUtils::WordToken>& words,std::string& opresult){
-            std::vector<int> locations;
-            std::map<int, std::string> ops;
-            int pars= 0;
-            for(int i=0;i<words.size();i++){
-                Utils::TokenUtils::WordToken word = words[i];
-                if(word.toString()=="(") pars++;
-                if(word.toString()==")") pars--;
-        
-                if(pars==0){
-                    if(word.toString()=="+"){
-                        locations.push_back(i);
-                        ops[i] = "+";
-                    }
-                    if(word.toString()=="-"){
-                        locations.push_back(i);
-                        ops[i] = "-";
-                    }
-                }
-            }
-            if(locations.empty()){
-                for(int i=0;i<words.size();i++){
-                    Utils::TokenUtils::WordToken word = words[i];
-                    if(word.toString()=="(") pars++;
-                    if(word.toString()==")") pars--;
-            
-                    if(pars==0){
-                        if(word.toString()=="*"){
-                            locations.push_back(i);
-                            ops[i] = "*";
-                        }
-                        if(word.toString()=="/"){
-                            locations.push_back(i);
-                            ops[i] = "/";
-                        }
-                        if(word.toString()=="%"){
-                            locations.push_back(i);
-                            ops[i] = "%";
-                        }
-                    }
-                }
-            }
-            if(!locations.empty()){
-                opresult = ops[locations.back()];
-                return locations.back();
+
+        CAKILGAN_TARGET("avx512f,avx512bw")
+        void tokenize_avx512bw(const char* ptr, size_t size, Token* out, const CharClassifier& classes) {
+            const AVX512BWClassifier classifier(classes.simd);
+            const __m512i firstHalf = _mm512_set_epi64(11, 10, 3, 2, 9, 8, 1, 0);
+            const __m512i secondHalf = _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4);
+            size_t i = 0;
+            for (; i + 64 <= size; i += 64) {
+                __m512i c = _mm512_loadu_si512(ptr + i);
+                __m512i type = classifier.classify(c);
+                __m512i lo = _mm512_unpacklo_epi8(type, c);
+                __m512i hi = _mm512_unpackhi_epi8(type, c);
+                _mm512_storeu_si512(out + i, _mm512_permutex2var_epi64(lo, firstHalf, hi));
+                _mm512_storeu_si512(out + i + 32, _mm512_permutex2var_epi64(lo, secondHalf, hi));
             }
-            else return -1;
+            tokenize_scalar(ptr + i, size - i, out + i, classes);
         }
-        void splitWithOperator(int lastGlobalOperator,std::vector<Utils::TokenUtils::WordToken>& words,std::vector<Utils::TokenUtils::WordToken>& left,std::vector<Utils::TokenUtils::WordToken>& right){
-            left = std::vector<Utils::TokenUtils::WordToken>(words.begin(),words.begin()+lastGlobalOperator);
-            right = std::vector<Utils::TokenUtils::WordToken>(words.begin()+lastGlobalOperator+1,words.end());
+
+        CAKILGAN_TARGET("avx512f,avx512bw")
+        void masks_avx512bw(const char* block, ClassMasks& masks, const CharClassifier& classes) {
+            const AVX512BWClassifier classifier(classes.simd);
+            __m512i type = classifier.classify(_mm512_loadu_si512(block));
+            masks.separator = _mm512_cmpeq_epi8_mask(type, _mm512_set1_epi8(static_cast<char>(TokenType::WHITESPACE)))
+                            | _mm512_cmpeq_epi8_mask(type, _mm512_set1_epi8(static_cast<char>(TokenType::PUNCTUATION)));
+            masks.numeric = _mm512_cmpeq_epi8_mask(type, _mm512_set1_epi8(static_cast<char>(TokenType::NUMERIC)));
+            masks.alphabetic = _mm512_cmpeq_epi8_mask(type, _mm512_set1_epi8(static_cast<char>(TokenType::ALPHABETIC)));
         }
-        
-        
-        // NOTE:: __look
-        bool removeReduntantPars(std::vector<Utils::TokenUtils::WordToken>& words) {
-            while (true) {
-                if (words.size() < 2 || words.front().toString() != "(" || words.back().toString() != ")")
-                    return false;
-        
-                int depth = 0;
-                bool valid = true;
-        
-                for (size_t i = 0; i < words.size(); ++i) {
-                    std::string val = words[i].toString();
-        
-                    if (val == "(") depth++;
-                    else if (val == ")") depth--;
-        
-                    if (depth == 0 && i != words.size() - 1) {
-                        valid = false;
-                        break;
-                    }
-                }
-        
-                if (valid) {
-                    words = std::vector<Utils::TokenUtils::WordToken>(words.begin() + 1, words.end() - 1);
-                } else {
-                    return false;
-                }
+
+        using TokenizeKernel = void (*)(const char*, size_t, Token*, const CharClassifier&);
+        using MaskKernel = void (*)(const char*, ClassMasks&, const CharClassifier&);
+
+        struct KernelSet {
+            TokenizeKernel tokenize;
+            MaskKernel masks;
+        };
+
+        void cpuid(int regs[4], int leaf, int subleaf) {
+        #if defined(_MSC_VER)
+            __cpuidex(regs, leaf, subleaf);
+        #else
+            __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+        #endif
+        }
+
+        uint64_t xgetbv0() {
+        #if defined(_MSC_VER)
+            return _xgetbv(0);
+        #else
+            uint32_t eax, edx;
+            __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return (static_cast<uint64_t>(edx) << 32) | eax;
+        #endif
+        }
+
+        SIMDLevel detectSIMDLevel() {
+            int regs[4];
+            cpuid(regs, 0, 0);
+            const int maxLeaf = regs[0];
+
+            cpuid(regs, 1, 0);
+            const bool sse42 = (regs[2] >> 20) & 1;
+            const bool osxsave = (regs[2] >> 27) & 1;
+            const bool avx = (regs[2] >> 28) & 1;
+            if (!sse42) return SIMDLevel::SCALAR;
+            if (!osxsave || !avx || maxLeaf < 7) return SIMDLevel::SSE42;
+
+            const uint64_t xcr0 = xgetbv0();
+            const bool ymmState = (xcr0 & 0x6) == 0x6;
+            const bool zmmState = (xcr0 & 0xE6) == 0xE6;
+
+            cpuid(regs, 7, 0);
+            const bool avx2 = (regs[1] >> 5) & 1;
+            const bool avx512f = (regs[1] >> 16) & 1;
+            const bool avx512bw = (regs[1] >> 30) & 1;
+
+            if (zmmState && avx512f && avx512bw) return SIMDLevel::AVX512BW;
+            if (ymmState && avx2) return SIMDLevel::AVX2;
+            return SIMDLevel::SSE42;
+        }
+
+        std::atomic<SIMDLevel>& activeLevel() {
+            static std::atomic<SIMDLevel> level{detectSIMDLevel()};
+            return level;
+        }
+
+        SIMDLevel getSIMDLevel() {
+            return activeLevel().load(std::memory_order_relaxed);
+        }
+
+        void setSIMDLevel(SIMDLevel level) {
+            static const SIMDLevel detected = detectSIMDLevel();
+            activeLevel().store(std::min(level, detected), std::memory_order_relaxed);
+        }
+
+        KernelSet selectKernels(SIMDLevel level) {
+            switch (level) {
+                case SIMDLevel::AVX512BW: return {tokenize_avx512bw, masks_avx512bw};
+                case SIMDLevel::AVX2: return {tokenize_avx2, masks_avx2};
+                case SIMDLevel::SSE42: return {tokenize_sse42, masks_sse42};
+                default: return {tokenize_scalar, masks_scalar};
             }
         }
-        
-        
-        Node* parse(std::vector<Utils::TokenUtils::WordToken>& words){
-            bool isRemovedSomething = removeReduntantPars(words);
-            
-            std::string op;
-            int lastGlobalOperatorV = lastGlobalOperator(words,op);
-        
-        
-            std::vector<Utils::TokenUtils::WordToken> left,right;
-            if(lastGlobalOperatorV==-1){
-                if(isRemovedSomething){
-                    parse(words);
+
+        // ASCII runs go through the vector kernel, every byte of a multi-byte sequence gets its codepoint's class
+        void tokenize_utf8(const char* ptr, size_t size, Token* out, const CharClassifier& classes, TokenizeKernel asciiKernel) {
+            size_t i = 0;
+            while (i < size) {
+                const size_t run = Utf8::asciiPrefix(std::string_view(ptr + i, size - i));
+                asciiKernel(ptr + i, run, out + i, classes);
+                i += run;
+                if (i == size) break;
+
+                char32_t codepoint;
+                size_t length = Utf8::decode(std::string_view(ptr + i, size - i), codepoint);
+                const TokenType type = length ? Utf8::classifyCodepoint(codepoint) : TokenType::UNKNOWN;
+                if (!length) length = 1;
+                for (size_t k = 0; k < length; ++k) {
+                    out[i + k] = Token(type, ptr[i + k]);
                 }
-                Node* n =  new Node(Utils::StringUtils::vec_to_str(words,""));
-                n->words = words;
-                return n;
-            }else{
-                splitWithOperator(lastGlobalOperatorV,words,left,right);
-                
-                Node* rtrn = new Node(op);
-                rtrn->left = parse(left);
-                rtrn->right = parse(right);
-                
-                return rtrn;
+                i += length;
             }
         }
-        
-        void trim(std::string& trimit){
-            for(int i=0;i<trimit.size();i++){
-                if(trimit[i]==' '){
-                    trimit.erase(trimit.begin()+i);
-                    i--;
-                }
+
+        void tokenize(std::string_view input, Token* out, const CharClassifier& classes, TokenizeKernel kernel) {
+            if (classes.utf8) {
+                tokenize_utf8(input.data(), input.size(), out, classes, kernel);
+            } else {
+                kernel(input.data(), input.size(), out, classes);
             }
         }
 
-        // ! using trigonometric funcs with radian values
-        float evaulate(Node* start){
-            
-            if(!start->left&&!start->right){
-                if(start->value._Starts_with("sin")){
-                    std::vector<Utils::TokenUtils::WordToken> temp (start->words.begin()+1,start->words.end());
-                    float val = evaulate(parse(temp));
-                    return sin(Utils::MathUtils::degtorad(val));
-                }
-                if(start->value._Starts_with("cos")){
-                    std::vector<Utils::TokenUtils::WordToken> temp (start->words.begin()+1,start->words.end());
-                    float val = evaulate(parse(temp));
-                    return cos(Utils::MathUtils::degtorad(val));
-                }
-                if(start->value._Starts_with("tan")){
-                    std::vector<Utils::TokenUtils::WordToken> temp (start->words.begin()+1,start->words.end());
-                    float val = evaulate(parse(temp));
-                    return tan(Utils::MathUtils::degtorad(val));
+        std::vector<Token> SIMDTokenize(std::string_view input, const CharClassifier& classes){
+            std::vector<Token> tokens(input.size());
+            tokenize(input, tokens.data(), classes, selectKernels(getSIMDLevel()).tokenize);
+            return tokens;
+        }
+
+        void SIMDTokenize(std::string_view input, std::vector<Token>& out, const CharClassifier& classes){
+            out.resize(input.size());
+            tokenize(input, out.data(), classes, selectKernels(getSIMDLevel()).tokenize);
+        }
+
+        void SIMDTokenize(std::string_view input, Token* out, const CharClassifier& classes){
+            tokenize(input, out, classes, selectKernels(getSIMDLevel()).tokenize);
+        }
+
+        void masks_from_tokens(const Token* tokens, size_t count, ClassMasks& masks) {
+            masks = {};
+            for (size_t i = 0; i < count; ++i) {
+                const TokenType t = tokens[i].tokenType;
+                const uint64_t bit = uint64_t{1} << i;
+                if (t == TokenType::WHITESPACE || t == TokenType::PUNCTUATION) masks.separator |= bit;
+                if (t == TokenType::NUMERIC) masks.numeric |= bit;
+                if (t == TokenType::ALPHABETIC) masks.alphabetic |= bit;
+            }
+        }
+
+        // blocks holding non-ASCII bytes are classified per codepoint, starting from the lead byte of a
+        // sequence that began in the previous block and running past the block end to finish the last one
+        void masks_utf8(std::string_view input, size_t base, size_t count, ClassMasks& masks,
+                        const CharClassifier& classes, const KernelSet& kernels) {
+            const char* data = input.data();
+            size_t start = base;
+            for (int back = 0; back < 3 && start > 0 && (static_cast<unsigned char>(data[start]) & 0xC0) == 0x80; ++back) --start;
+            const size_t end = std::min(input.size(), base + count + 3);
+
+            Token window[64 + 6];
+            tokenize_utf8(data + start, end - start, window, classes, kernels.tokenize);
+            masks_from_tokens(window + (base - start), count, masks);
+        }
+
+        void segmentWords(std::string_view input, std::vector<WordSpan>& out, const CharClassifier& classes){
+            const KernelSet kernels = selectKernels(getSIMDLevel());
+            const char* data = input.data();
+            const size_t size = input.size();
+
+            bool inWord = false;
+            bool allNumeric = true;
+            bool allAlpha = true;
+            size_t wordStart = 0;
+            size_t separatorEnd = 0;
+
+            auto emitWord = [&](size_t end) {
+                WordTokenType type = allNumeric ? WordTokenTypes::ALL_NUMBER : allAlpha ? WordTokenTypes::ALL_ALPHA : WordTokenTypes::UNKNOWN;
+                out.push_back({wordStart, static_cast<uint32_t>(end - wordStart), type});
+                inWord = false;
+            };
+
+            alignas(64) char tail[64];
+            ClassMasks masks;
+            for (size_t base = 0; base < size; base += 64) {
+                const size_t count = std::min<size_t>(64, size - base);
+                if (classes.utf8 && Utf8::asciiPrefix(input.substr(base, count)) != count) {
+                    masks_utf8(input, base, count, masks, classes, kernels);
+                } else if (count == 64) {
+                    kernels.masks(data + base, masks, classes);
+                } else {
+                    std::memset(tail, 0, sizeof(tail));
+                    std::memcpy(tail, data + base, count);
+                    kernels.masks(tail, masks, classes);
                 }
-                if(start->value._Starts_with("log")){
-                    std::vector<Utils::TokenUtils::WordToken> temp (start->words.begin()+1,start->words.end());
-                    float val = evaulate(parse(temp));
-                    return log10(val);
+
+                uint64_t remaining = count == 64 ? ~uint64_t{0} : (uint64_t{1} << count) - 1;
+                while (remaining) {
+                    if (inWord) {
+                        const uint64_t separators = masks.separator & remaining;
+                        const int end = separators ? std::countr_zero(separators) : 64;
+                        const uint64_t part = end == 64 ? remaining : remaining & ((uint64_t{1} << end) - 1);
+                        allNumeric = allNumeric && (masks.numeric & part) == part;
+                        allAlpha = allAlpha && (masks.alphabetic & part) == part;
+                        if (!separators) break;
+                        emitWord(base + end);
+                        remaining &= ~part;
+                    } else {
+                        const int index = std::countr_zero(remaining);
+                        const size_t position = base + index;
+                        if ((masks.separator >> index) & 1) {
+                            // trailing bytes of a multi-byte separator already emitted as one span
+                            if (position >= separatorEnd) {
+                                size_t length = 1;
+                                char32_t codepoint;
+                                if (classes.utf8 && static_cast<unsigned char>(data[position]) >= 0xC0) {
+                                    length = std::max<size_t>(1, Utf8::decode(input.substr(position), codepoint));
+                                }
+                                const bool isOperator = classes.isOperator(data[position]);
+                                out.push_back({position, static_cast<uint32_t>(length), isOperator ? WordTokenTypes::OPERATOR : WordTokenTypes::UNKNOWN});
+                                separatorEnd = position + length;
+                            }
+                            remaining &= remaining - 1;
+                        } else {
+                            inWord = true;
+                            allNumeric = true;
+                            allAlpha = true;
+                            wordStart = position;
+                        }
+                    }
                 }
-                float val = stof(start->value);
-                return val;
             }
-        
-            float left = evaulate(start->left);
-            float right = evaulate(start->right);
-            if(start->value=="+") return left+right;
-            if(start->value=="-") return left-right;
-            if(start->value=="*") return left*right;
-            if(start->value=="/") return left/right;
-            if(start->value=="%") return (int)left%(int)right;
-            throw std::exception("invalid operator!");
+            if (inWord) emitWord(size);
         }
-        float basicParseAndEvaulateMathExpression(std::vector<WordToken> tokenizedText){
-            return evaulate(parse(tokenizedText));
+
+        std::vector<WordSpan> segmentWords(std::string_view input, const CharClassifier& classes){
+            std::vector<WordSpan> spans;
+            spans.reserve(input.size() / 4 + 1);
+            segmentWords(input, spans, classes);
+            return spans;
+        }
+
+        std::vector<WordToken> spaceAndPunctuationWordTokenize(const std::vector<Token>& tokens, const CharClassifier& classes){
+            std::vector<WordToken> words;
+            auto wordStart = tokens.begin();
+            bool allNumeric = true;
+            bool allAlpha = true;
+
+            auto emitWord = [&](std::vector<Token>::const_iterator end) {
+                if (wordStart == end) return;
+                WordTokenType type = allNumeric ? WordTokenTypes::ALL_NUMBER : allAlpha ? WordTokenTypes::ALL_ALPHA : WordTokenTypes::UNKNOWN;
+                words.emplace_back(std::vector<Token>(wordStart, end), type);
+            };
+
+            for (auto it = tokens.begin(); it != tokens.end(); ++it) {
+                if (it->tokenType == TokenType::WHITESPACE || it->tokenType == TokenType::PUNCTUATION) {
+                    emitWord(it);
+                    const bool isOperator = classes.isOperator(it->literalValue);
+                    words.emplace_back(std::vector<Token>(it, it + 1), isOperator ? WordTokenTypes::OPERATOR : WordTokenTypes::UNKNOWN);
+                    wordStart = it + 1;
+                    allNumeric = true;
+                    allAlpha = true;
+                } else {
+                    allNumeric = allNumeric && it->tokenType == TokenType::NUMERIC;
+                    allAlpha = allAlpha && it->tokenType == TokenType::ALPHABETIC;
+                }
+            }
+            emitWord(tokens.end());
+
+            return words;
         }
     }
 }
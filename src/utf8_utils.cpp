@@ -0,0 +1,214 @@
+#include <cstring>
+#include <bit>
+#include <algorithm>
+#include <token_utils.h>
+
+namespace Utils::TokenUtils::Utf8
+{
+    namespace {
+        // error bits of the lookup validator, see Keiser & Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte"
+        constexpr uint8_t TOO_SHORT = 1 << 0;
+        constexpr uint8_t TOO_LONG = 1 << 1;
+        constexpr uint8_t OVERLONG_3 = 1 << 2;
+        constexpr uint8_t TOO_LARGE = 1 << 3;
+        constexpr uint8_t SURROGATE = 1 << 4;
+        constexpr uint8_t OVERLONG_2 = 1 << 5;
+        constexpr uint8_t TOO_LARGE_1000 = 1 << 6;
+        constexpr uint8_t OVERLONG_4 = 1 << 6;
+        constexpr uint8_t TWO_CONTS = 1 << 7;
+        constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+        // indexed by the high nibble of the previous byte
+        alignas(16) constexpr uint8_t byte1High[16] = {
+            TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+            TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+            TOO_SHORT | OVERLONG_2,
+            TOO_SHORT,
+            TOO_SHORT | OVERLONG_3 | SURROGATE,
+            TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+        };
+        // indexed by the low nibble of the previous byte
+        alignas(16) constexpr uint8_t byte1Low[16] = {
+            CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+            CARRY | OVERLONG_2,
+            CARRY,
+            CARRY,
+            CARRY | TOO_LARGE,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000
+        };
+        // indexed by the high nibble of the current byte
+        alignas(16) constexpr uint8_t byte2High[16] = {
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+        };
+
+        size_t sequenceLength(unsigned char lead) {
+            if (lead < 0x80) return 1;
+            if (lead < 0xC2) return 0;
+            if (lead < 0xE0) return 2;
+            if (lead < 0xF0) return 3;
+            if (lead < 0xF5) return 4;
+            return 0;
+        }
+
+        bool validate_scalar(const unsigned char* ptr, size_t size) {
+            size_t i = 0;
+            while (i < size) {
+                if (i + 8 <= size) {
+                    uint64_t word;
+                    std::memcpy(&word, ptr + i, sizeof(word));
+                    if (!(word & 0x8080808080808080ull)) {
+                        i += 8;
+                        continue;
+                    }
+                }
+                char32_t codepoint;
+                const size_t length = decode(std::string_view(reinterpret_cast<const char*>(ptr + i), size - i), codepoint);
+                if (!length) return false;
+                i += length;
+            }
+            return true;
+        }
+
+        struct AVX2Validator {
+            __m256i error;
+            __m256i prevInput;
+            __m256i prevIncomplete;
+
+            CAKILGAN_TARGET("avx2")
+            AVX2Validator(): error(_mm256_setzero_si256()), prevInput(_mm256_setzero_si256()), prevIncomplete(_mm256_setzero_si256()) {}
+
+            CAKILGAN_TARGET("avx2")
+            static __m256i lookup(const uint8_t (&table)[16], __m256i index) {
+                return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(table))), index);
+            }
+
+            CAKILGAN_TARGET("avx2")
+            void check(__m256i input) {
+                if (!_mm256_movemask_epi8(input)) {
+                    error = _mm256_or_si256(error, prevIncomplete);
+                    prevIncomplete = _mm256_setzero_si256();
+                    prevInput = input;
+                    return;
+                }
+
+                const __m256i nibble = _mm256_set1_epi8(0x0F);
+                const __m256i shifted = _mm256_permute2x128_si256(prevInput, input, 0x21);
+                const __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+                const __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+                const __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+
+                const __m256i special = _mm256_and_si256(
+                    _mm256_and_si256(lookup(byte1High, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                                     lookup(byte1Low, _mm256_and_si256(prev1, nibble))),
+                    lookup(byte2High, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+                // continuations expected after a 3 or 4 byte lead two or three positions back
+                const __m256i thirdByte = _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+                const __m256i fourthByte = _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+                const __m256i must23 = _mm256_and_si256(_mm256_or_si256(thirdByte, fourthByte), _mm256_set1_epi8(static_cast<char>(0x80)));
+                error = _mm256_or_si256(error, _mm256_xor_si256(must23, special));
+
+                const __m256i maxValue = _mm256_setr_epi8(
+                    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                    static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1), static_cast<char>(0xC0 - 1));
+                prevIncomplete = _mm256_subs_epu8(input, maxValue);
+                prevInput = input;
+            }
+        };
+
+        CAKILGAN_TARGET("avx2")
+        bool validate_avx2(const unsigned char* ptr, size_t size) {
+            AVX2Validator validator;
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32) {
+                validator.check(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr + i)));
+            }
+            if (i < size) {
+                alignas(32) unsigned char tail[32] = {};
+                std::memcpy(tail, ptr + i, size - i);
+                validator.check(_mm256_load_si256(reinterpret_cast<const __m256i*>(tail)));
+            }
+            const __m256i error = _mm256_or_si256(validator.error, validator.prevIncomplete);
+            return _mm256_testz_si256(error, error);
+        }
+    }
+
+    bool validate(std::string_view input) {
+        const auto* ptr = reinterpret_cast<const unsigned char*>(input.data());
+        if (Tokenizer::getSIMDLevel() >= SIMDLevel::AVX2) return validate_avx2(ptr, input.size());
+        return validate_scalar(ptr, input.size());
+    }
+
+    size_t asciiPrefix(std::string_view input) {
+        const char* ptr = input.data();
+        const size_t size = input.size();
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            const int high = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + i)));
+            if (high) return i + std::countr_zero(static_cast<unsigned>(high));
+        }
+        while (i < size && static_cast<unsigned char>(ptr[i]) < 0x80) ++i;
+        return i;
+    }
+
+    size_t decode(std::string_view input, char32_t& codepoint) {
+        if (input.empty()) return 0;
+        const auto* ptr = reinterpret_cast<const unsigned char*>(input.data());
+        const size_t length = sequenceLength(ptr[0]);
+        if (!length || length > input.size()) return 0;
+        if (length == 1) {
+            codepoint = ptr[0];
+            return 1;
+        }
+
+        char32_t value = ptr[0] & (0x7F >> length);
+        for (size_t k = 1; k < length; ++k) {
+            if ((ptr[k] & 0xC0) != 0x80) return 0;
+            value = (value << 6) | (ptr[k] & 0x3F);
+        }
+        // overlong three and four byte forms, surrogates and values past U+10FFFF
+        if ((length == 3 && value < 0x800) || (length == 4 && value < 0x10000)) return 0;
+        if ((value >= 0xD800 && value <= 0xDFFF) || value > 0x10FFFF) return 0;
+        codepoint = value;
+        return length;
+    }
+
+    TokenType classifyAt(std::string_view input, size_t index, const CharClassifier& classes) {
+        if (!classes.utf8 || static_cast<unsigned char>(input[index]) < 0x80) return classes.classify(input[index]);
+        char32_t codepoint;
+        return decode(input.substr(index), codepoint) ? classifyCodepoint(codepoint) : TokenType::UNKNOWN;
+    }
+
+    size_t lastCharacter(std::string_view input) {
+        const size_t last = input.size() - 1;
+        size_t start = last;
+        for (int back = 0; back < 3 && start > 0 && (static_cast<unsigned char>(input[start]) & 0xC0) == 0x80; ++back) --start;
+        char32_t codepoint;
+        return decode(input.substr(start), codepoint) == input.size() - start ? start : last;
+    }
+
+    size_t incompleteSuffix(std::string_view input) {
+        for (size_t back = 1; back <= std::min<size_t>(3, input.size()); ++back) {
+            const auto c = static_cast<unsigned char>(input[input.size() - back]);
+            if ((c & 0xC0) == 0x80) continue;
+            return sequenceLength(c) > back ? back : 0;
+        }
+        return 0;
+    }
+}
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+# Regenerates src/unicode_tables.cpp from the General_Category data shipped with Python's unicodedata.
+# usage: python3 tools/gen_unicode_tables.py > src/unicode_tables.cpp
+import unicodedata
+
+# values match Utils::TokenUtils::TokenType
+ALPHABETIC, NUMERIC, PUNCTUATION, WHITESPACE, UNKNOWN, NEWLINE = range(6)
+
+LEAF = 128      # codepoints per leaf, packed 2 per byte
+MID = 32        # leaves per mid block
+TOP_SHIFT = 12  # log2(LEAF * MID)
+
+
+def classify(cp):
+    if cp in (0x0A, 0x85, 0x2028, 0x2029):
+        return NEWLINE
+    category = unicodedata.category(chr(cp))
+    if category == 'Zs' or cp in (0x09, 0x0B, 0x0C, 0x0D):
+        return WHITESPACE
+    if category[0] == 'L' or category in ('Mn', 'Mc', 'Me', 'Nl'):
+        return ALPHABETIC
+    if category == 'Nd':
+        return NUMERIC
+    if category[0] in 'PS':
+        return PUNCTUATION
+    return UNKNOWN
+
+
+def dedupe(rows):
+    unique, index = {}, []
+    for row in rows:
+        index.append(unique.setdefault(row, len(unique)))
+    return list(unique), index
+
+
+def main():
+    leaves, leaf_index = dedupe(tuple(classify(cp) for cp in range(b * LEAF, (b + 1) * LEAF))
+                                for b in range(0x110000 // LEAF))
+    mids, top = dedupe(tuple(leaf_index[m * MID:(m + 1) * MID]) for m in range(len(leaf_index) // MID))
+    assert len(leaves) < 256 and len(mids) < 256
+
+    def rows(data, width):
+        return ',\n'.join('        ' + ', '.join(data[i:i + width]) for i in range(0, len(data), width))
+
+    print('// generated by tools/gen_unicode_tables.py from Unicode %s, do not edit' % unicodedata.unidata_version)
+    print('#include <token_utils.h>')
+    print()
+    print('namespace Utils::TokenUtils::Utf8')
+    print('{')
+    print('    constexpr uint8_t unicodeTop[%d] = {' % len(top))
+    print(rows(['%d' % v for v in top], 24))
+    print('    };')
+    print('    constexpr uint8_t unicodeMid[%d][%d] = {' % (len(mids), MID))
+    print(',\n'.join('        {' + ', '.join('%d' % v for v in mid) + '}' for mid in mids))
+    print('    };')
+    print('    constexpr uint8_t unicodeLeaf[%d][%d] = {' % (len(leaves), LEAF // 2))
+    print(',\n'.join('        {' + ', '.join('0x%02x' % (leaf[i] | (leaf[i + 1] << 4)) for i in range(0, LEAF, 2)) + '}'
+                     for leaf in leaves))
+    print('    };')
+    print()
+    print('    TokenType classifyCodepoint(char32_t codepoint){')
+    print('        if (codepoint > 0x10FFFF) return TokenType::UNKNOWN;')
+    print('        const uint8_t mid = unicodeTop[codepoint >> %d];' % TOP_SHIFT)
+    print('        const uint8_t leaf = unicodeMid[mid][(codepoint >> 7) & %d];' % (MID - 1))
+    print('        const uint8_t packed = unicodeLeaf[leaf][(codepoint & 0x7F) >> 1];')
+    print('        return static_cast<TokenType>((codepoint & 1) ? packed >> 4 : packed & 0x0F);')
+    print('    }')
+    print('}')
+
+
+if __name__ == '__main__':
+    main()
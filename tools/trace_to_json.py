@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+# Converts a binary trace written with TraceFormat::BINARY into Chrome traceEvents JSON.
+# usage: python3 tools/trace_to_json.py trace.bin > trace.json
+import json
+import struct
+import sys
+
+MAGIC = b'BOLTTRC\0'
+VERSION = 1
+
+# values match Utils::TimeUtils::TraceRecord
+END, NAME, EVENT, TRACK_NAME, DROPPED, COUNTED_EVENT = range(6)
+COUNTERS = ('cycles', 'instructions', 'cache_misses', 'branch_misses')
+
+
+class TruncatedTrace(ValueError):
+    pass
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def byte(self):
+        if self.pos >= len(self.data):
+            raise TruncatedTrace('truncated trace at byte %d' % self.pos)
+        value = self.data[self.pos]
+        self.pos += 1
+        return value
+
+    def varint(self):
+        value, shift = 0, 0
+        while True:
+            byte = self.byte()
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if byte < 0x80:
+                return value
+
+    def string(self):
+        length = self.varint()
+        if self.pos + length > len(self.data):
+            raise TruncatedTrace('truncated trace at byte %d' % self.pos)
+        text = self.data[self.pos:self.pos + length]
+        self.pos += length
+        return text.decode('utf-8', 'replace')
+
+
+def microseconds(ns):
+    # same rendering as Instrumentor::WriteMicroseconds
+    sign = '-' if ns < 0 else ''
+    ns = abs(ns)
+    return '%s%d.%03d' % (sign, ns // 1000, ns % 1000)
+
+
+def convert(data, out):
+    if data[:8] != MAGIC:
+        raise ValueError('not a binary trace')
+    version, _flags = struct.unpack_from('<II', data, 8)
+    if version != VERSION:
+        raise ValueError('unsupported trace version %d' % version)
+
+    reader = Reader(data)
+    reader.pos = 16
+    state = {'names': {}, 'start': 0}
+    out.write('{"otherData": {},"traceEvents":[')
+    # a trace cut short by a crash has no END record and may stop inside one,
+    # every complete record up to there is still written
+    while reader.pos < len(data):
+        try:
+            text = read_record(reader, state)
+        except TruncatedTrace:
+            break
+        if text is None:
+            break
+        out.write(text)
+    out.write('{}]}')
+
+
+# the JSON for one record, empty for records that only update state, None at END
+def read_record(reader, state):
+    tag = reader.byte()
+    if tag == END:
+        return None
+    if tag == NAME:
+        identifier = reader.varint()
+        state['names'][identifier] = reader.string()
+        return ''
+    if tag == EVENT or tag == COUNTED_EVENT:
+        name = state['names'][reader.varint()]
+        tid = reader.varint()
+        delta = reader.varint()
+        start = state['start'] + ((delta >> 1) ^ -(delta & 1))
+        duration = reader.varint()
+        args = ''
+        if tag == COUNTED_EVENT:
+            values = ','.join('"%s":%d' % (counter, reader.varint()) for counter in COUNTERS)
+            args = '"args":{%s},' % values
+        state['start'] = start
+        return ('{%s"cat":"function","dur":%s,"name":%s,"ph":"X","pid":0,"tid":%d,"ts":%s},'
+                % (args, microseconds(duration), json.dumps(name), tid, microseconds(start)))
+    if tag == TRACK_NAME:
+        tid = reader.varint()
+        return ('{"name":"thread_name","ph":"M","pid":0,"tid":%d,"args":{"name":%s}},'
+                % (tid, json.dumps(reader.string())))
+    if tag == DROPPED:
+        return '{"name":"dropped_events","ph":"M","pid":0,"tid":0,"args":{"count":%d}},' % reader.varint()
+    raise ValueError('unknown record %d at byte %d' % (tag, reader.pos - 1))
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit('usage: trace_to_json.py trace.bin > trace.json')
+    with open(sys.argv[1], 'rb') as trace:
+        convert(trace.read(), sys.stdout)
+
+
+if __name__ == '__main__':
+    main()